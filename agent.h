@@ -32,6 +32,12 @@ public:
 	virtual action take_action(const board& b) { return action(); }
 	virtual bool check_for_win(const board& b) { return false; }
 
+	// the clock in seconds, as GTP time_settings and time_left, agents ignoring the clock keep these
+	// byo_yomi_stones == 0 with byo_yomi_time > 0 means no time limit
+	virtual void time_settings(double main_time, double byo_yomi_time, int byo_yomi_stones) {}
+	// stones == 0 means time is the main time left, otherwise time is left for the next stones moves
+	virtual void time_left(double time, int stones) {}
+
 public:
 	virtual std::string property(const std::string& key) const { return meta.at(key); }
 	virtual void notify(const std::string& msg) { meta[msg.substr(0, msg.find('='))] = { msg.substr(msg.find('=') + 1) }; }
@@ -85,15 +91,11 @@ public:
 	}
 
 	virtual action take_action(const board& state) override {
-		uint128 avl = state.available(who);
+		board::bitboard avl = state.available(who);
 		int bc = board::bit_count(avl);
 		if (!bc) return action();
 		std::uniform_int_distribution<int> dis(0, bc - 1);
-		int idx = dis(engine);
-		while (idx--) {
-			avl = board::reset(avl);
-		}
-		return action::place(board::bit_scan(board::lsb(avl)), who);
+		return action::place(board::nth_one(avl, dis(engine)), who);
 		// std::shuffle(space.begin(), space.end(), engine);
 		// for (const action::place& move : space) {
 		// 	board after = state;
@@ -0,0 +1,184 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * benchmark.h: Throughput benchmarks of the board, perft and random playouts
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "board.h"
+
+/**
+ * measure the move generator and the random playouts from a fixed position
+ *
+ * the counts only depend on the position, the depth, the number of playouts, and the seed,
+ * so that the summaries of two builds can be diffed to catch regressions of board::place
+ */
+class benchmark {
+public:
+	benchmark(const board& root = board(), size_t threads = 1, unsigned seed = 0)
+		: root(root), threads(std::max<size_t>(threads, 1)), seed(seed) {}
+
+public:
+	/**
+	 * load the position from a SGF file, B[] and W[] are played in order,
+	 * AB[], AW[], and PL[] are applied as setup, other properties are ignored
+	 */
+	static board load_sgf(const std::string& path) {
+		std::ifstream in(path, std::ios::in);
+		if (!in.is_open()) throw std::invalid_argument("cannot open sgf: " + path);
+		std::stringstream buf;
+		buf << in.rdbuf();
+		std::string sgf = buf.str();
+
+		board b;
+		std::string prop;
+		for (size_t i = 0; i < sgf.size(); ++i) {
+			char ch = sgf[i];
+			if (std::isupper(ch)) {
+				if (i == 0 || !std::isupper(sgf[i - 1])) prop.clear();
+				prop += ch;
+				continue;
+			}
+			if (ch != '[') {
+				if (!std::isspace(ch)) prop.clear();
+				continue;
+			}
+			size_t end = sgf.find(']', i);
+			if (end == std::string::npos) throw std::invalid_argument("unterminated sgf value: " + path);
+			std::string value = sgf.substr(i + 1, end - i - 1);
+			i = end;
+
+			if (prop == "PL") {
+				b.info({std::toupper(value[0]) == 'W' ? board::white : board::black});
+				continue;
+			}
+			if (prop != "B" && prop != "W" && prop != "AB" && prop != "AW") continue;
+			board::piece_type who = prop.back() == 'B' ? board::black : board::white;
+			if (value.size() != 2) throw std::invalid_argument("invalid sgf move: " + prop + "[" + value + "]");
+			board::point p(value[0] - 'a', board::size_y - 1 - (value[1] - 'a'));
+			if (p.x < 0 || p.x >= board::size_x || p.y < 0 || p.y >= board::size_y)
+				throw std::invalid_argument("invalid sgf move: " + prop + "[" + value + "]");
+
+			board::data turn = b.info();
+			if (prop.size() == 2) b.info({who}); // setup stones ignore the turn
+			if (b.place(p, who) != board::legal)
+				throw std::invalid_argument("illegal sgf move: " + prop + "[" + value + "]");
+			if (prop.size() == 2) b.info(turn);
+		}
+		return b;
+	}
+
+	/**
+	 * count the leaves at each depth up to the given depth, the moves at the root are split among the threads
+	 *
+	 * the format is
+	 * perft(3) = 357840, 0.031 s, 11543225 leaves/s
+	 */
+	void perft(unsigned depth) const {
+		std::cout << "perft from " << (root.info().who_take_turns == board::black ? "black" : "white")
+		          << ", " << threads << " thread(s)" << std::endl;
+		for (unsigned d = 1; d <= depth; ++d) {
+			std::vector<int> moves;
+			for (auto av = root.available(); av; av = board::reset(av))
+				moves.push_back(board::bit_scan(board::lsb(av)));
+
+			std::atomic<size_t> next(0);
+			std::atomic<uint64_t> total(0);
+			auto begin = std::chrono::steady_clock::now();
+			run([&] {
+				board b = root;
+				board::undo rec;
+				uint64_t n = 0;
+				for (size_t k; (k = next++) < moves.size(); ) {
+					b.try_place(moves[k], rec);
+					n += count(b, d - 1);
+					b.unplace(rec);
+				}
+				total += n;
+			});
+			double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+			std::cout << "perft(" << d << ") = " << total << ", " << std::fixed << std::setprecision(3) << sec << " s, "
+			          << std::setprecision(0) << total / std::max(sec, 1e-9) << " leaves/s" << std::endl;
+			std::cout.unsetf(std::ios::floatfield);
+		}
+	}
+
+	/**
+	 * run n uniformly random playouts, each block of playouts is seeded by the seed and its index
+	 *
+	 * the format is
+	 * playouts = 100000, win = 52.3%|47.7%, op = 61.472, 1.203 s, 83111 playouts/s, 5109042 ops
+	 *
+	 * where 'win' is the win rate of black|white, and 'op' is the average moves per playout
+	 */
+	void playout(size_t n) const {
+		constexpr size_t block = 1024;
+		std::atomic<size_t> next(0);
+		std::atomic<uint64_t> wins[3] = {0, 0, 0}, moves(0);
+		auto begin = std::chrono::steady_clock::now();
+		run([&] {
+			uint64_t w[3] = {0, 0, 0}, m = 0;
+			for (size_t k; (k = next++) * block < n; ) {
+				std::default_random_engine gen(seed + k);
+				for (size_t i = k * block; i < std::min(n, (k + 1) * block); ++i) {
+					board b = root;
+					while (auto mv = b.random_action(gen)) b.place(*mv), ++m;
+					++w[board::opponent(b.info().who_take_turns)];
+				}
+			}
+			wins[1] += w[1], wins[2] += w[2], moves += m;
+		});
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		std::cout << "playout from " << (root.info().who_take_turns == board::black ? "black" : "white")
+		          << ", " << threads << " thread(s), seed = " << seed << std::endl;
+		std::cout << std::fixed << "playouts = " << n << ", win = " << std::setprecision(1)
+		          << wins[1] * 100.0 / std::max<size_t>(n, 1) << "%|" << wins[2] * 100.0 / std::max<size_t>(n, 1) << "%, "
+		          << "op = " << std::setprecision(3) << moves / double(std::max<size_t>(n, 1)) << ", "
+		          << sec << " s, " << std::setprecision(0) << n / std::max(sec, 1e-9) << " playouts/s, "
+		          << moves / std::max(sec, 1e-9) << " ops" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+	}
+
+protected:
+	// the leaves at the given depth below b, the last depth is counted by the available moves
+	static uint64_t count(board& b, unsigned depth) {
+		if (depth == 0) return 1;
+		auto av = b.available();
+		if (depth == 1) return board::bit_count(av);
+		uint64_t n = 0;
+		board::undo rec;
+		for (; av; av = board::reset(av)) {
+			b.try_place(board::bit_scan(board::lsb(av)), rec);
+			n += count(b, depth - 1);
+			b.unplace(rec);
+		}
+		return n;
+	}
+
+	template<class job>
+	void run(job work) const {
+		std::vector<std::thread> pool;
+		for (size_t t = 1; t < threads; ++t) pool.emplace_back(work);
+		work();
+		for (auto& th : pool) th.join();
+	}
+
+private:
+	board root;
+	size_t threads;
+	unsigned seed;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "uint128.h"
+
+/*
+    multi-word bitboard for boards larger than 128 cells
+    bit i is bit (i % 64) of word (i / 64)
+*/
+template<std::size_t N>
+class wide_bitboard {
+public:
+    constexpr wide_bitboard(std::uint64_t v = 0) : w{} { w[0] = v; }
+
+    constexpr wide_bitboard operator &(const wide_bitboard& b) const { wide_bitboard r; for (auto i = 0u; i < N; ++i) r.w[i] = w[i] & b.w[i]; return r; }
+    constexpr wide_bitboard operator |(const wide_bitboard& b) const { wide_bitboard r; for (auto i = 0u; i < N; ++i) r.w[i] = w[i] | b.w[i]; return r; }
+    constexpr wide_bitboard operator ^(const wide_bitboard& b) const { wide_bitboard r; for (auto i = 0u; i < N; ++i) r.w[i] = w[i] ^ b.w[i]; return r; }
+    constexpr wide_bitboard operator ~() const { wide_bitboard r; for (auto i = 0u; i < N; ++i) r.w[i] = ~w[i]; return r; }
+    constexpr wide_bitboard& operator &=(const wide_bitboard& b) { return *this = *this & b; }
+    constexpr wide_bitboard& operator |=(const wide_bitboard& b) { return *this = *this | b; }
+    constexpr wide_bitboard& operator ^=(const wide_bitboard& b) { return *this = *this ^ b; }
+
+    constexpr wide_bitboard operator <<(int s) const {
+        wide_bitboard r;
+        int ws = s / 64, bs = s % 64;
+        for (int i = N - 1; i >= ws; --i) {
+            r.w[i] = w[i - ws] << bs;
+            if (bs && i - ws - 1 >= 0) r.w[i] |= w[i - ws - 1] >> (64 - bs);
+        }
+        return r;
+    }
+    constexpr wide_bitboard operator >>(int s) const {
+        wide_bitboard r;
+        int ws = s / 64, bs = s % 64;
+        for (int i = 0; i + ws < int(N); ++i) {
+            r.w[i] = w[i + ws] >> bs;
+            if (bs && i + ws + 1 < int(N)) r.w[i] |= w[i + ws + 1] << (64 - bs);
+        }
+        return r;
+    }
+    constexpr wide_bitboard& operator <<=(int s) { return *this = *this << s; }
+    constexpr wide_bitboard& operator >>=(int s) { return *this = *this >> s; }
+
+    constexpr bool operator ==(const wide_bitboard& b) const { return w == b.w; }
+    constexpr bool operator !=(const wide_bitboard& b) const { return !(*this == b); }
+    constexpr bool operator <(const wide_bitboard& b) const {
+        for (int i = N - 1; i >= 0; --i) if (w[i] != b.w[i]) return w[i] < b.w[i];
+        return false;
+    }
+    constexpr explicit operator bool() const {
+        for (auto v : w) if (v) return true;
+        return false;
+    }
+
+public:
+    std::array<std::uint64_t, N> w;
+};
+
+template<std::size_t N>
+constexpr wide_bitboard<N> lsb(const wide_bitboard<N>& v) {
+    wide_bitboard<N> r;
+    for (auto i = 0u; i < N; ++i) if (v.w[i]) { r.w[i] = v.w[i] & -v.w[i]; break; }
+    return r;
+}
+
+template<std::size_t N>
+constexpr wide_bitboard<N> reset(const wide_bitboard<N>& v) {
+    wide_bitboard<N> r = v;
+    for (auto i = 0u; i < N; ++i) if (r.w[i]) { r.w[i] &= r.w[i] - 1; break; }
+    return r;
+}
+
+template<std::size_t N>
+inline int bit_scan(const wide_bitboard<N>& v) {
+    for (auto i = 0u; i < N; ++i) if (v.w[i]) return 64 * i + bit_scan(uint128(v.w[i]));
+    return 0;
+}
+
+template<std::size_t N>
+inline int bit_count(const wide_bitboard<N>& v) {
+    int re = 0;
+    for (auto x : v.w) re += bit_count(uint128(x));
+    return re;
+}
+
+template<std::size_t N>
+inline int nth_one(const wide_bitboard<N>& v, int n) {
+    for (auto i = 0u; i < N; ++i) {
+        int cnt = bit_count(uint128(v.w[i]));
+        if (n < cnt) return 64 * i + nth_one(uint128(v.w[i]), n);
+        n -= cnt;
+    }
+    return -1;
+}
+
+/*
+    the bitboard type of a board with the given number of cells,
+    a single uint128 when it fits, otherwise a multi-word bitboard
+*/
+template<std::size_t cells>
+using bitboard_of = std::conditional_t<(cells <= 128), uint128, wide_bitboard<(cells + 63) / 64>>;
@@ -10,6 +10,7 @@
 #pragma once
 #include <array>
 #include <list>
+#include <vector>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
@@ -20,7 +21,41 @@
 #include <optional>
 #include <unordered_map>
 
-#include "uint128.h"
+#include "bitboard.h"
+
+/**
+ * the cells satisfying p(x, y) on a size_x * size_y board as a bitboard
+ */
+template<class bitboard, class pred>
+constexpr bitboard make_mask(int size_x, int size_y, pred p) {
+	bitboard re = 0;
+	for (int x = 0; x < size_x; ++x)
+		for (int y = 0; y < size_y; ++y)
+			if (p(x, y)) re |= bitboard(1) << (x * size_y + y);
+	return re;
+}
+
+/**
+ * hollow layouts of the board, placed as the template argument of the board
+ * hollow(x, y) returns true when [x][y] is hollow on a size_x * size_y board
+ */
+struct hollow_none {
+	static constexpr bool hollow(int x, int y, int size_x, int size_y) { return false; }
+};
+
+/**
+ * the cross of 9x9 Hollow NoGo, generalized to other odd sizes:
+ * the cells on the center row and column, except the center, its neighbors, and the border
+ */
+struct hollow_cross {
+	static constexpr bool hollow(int x, int y, int size_x, int size_y) {
+		int cx = size_x / 2, cy = size_y / 2;
+		int dx = x > cx ? x - cx : cx - x, dy = y > cy ? y - cy : cy - y;
+		if (x == cx && dy >= 2 && dy < cy) return true;
+		if (y == cy && dx >= 2 && dx < cx) return true;
+		return false;
+	}
+};
 
 /**
  * definition for the 9x9 board
@@ -47,10 +82,14 @@
  *
  * for 9x9 Hollow NoGo, the empty locations are hollow but not empty, cannot be counted as liberty,
  * i.e., there are also borders at the center of the board
+ *
+ * the board is a template over its width (size_x), height (size_y), and hollow layout,
+ * the bitboard is a uint128 when it fits, otherwise a multi-word bitboard
  */
-class board {
+template<int width, int height, class layout = hollow_cross>
+class basic_board_state {
 public:
-	enum size { size_x = 9u, size_y = 9u, hollow_x = 3u, hollow_y = 3u };
+	static constexpr int size_x = width, size_y = height;
 	enum piece_type { empty = 0u, black = 1u, white = 2u, hollow = 3u, unknown = -1u };
 	// typedef uint32_t cell;
 	// typedef std::array<cell, size_y> column;
@@ -58,42 +97,24 @@ public:
 	struct data {
 		piece_type who_take_turns;
 	};
-	typedef uint64_t score;
-	typedef int reward;
-	typedef uint128 bitboard;
+	typedef bitboard_of<size_x * size_y> bitboard;
 
 public:
-	board() : attr({piece_type::black}) { 
+	basic_board_state() : key(0), attr({piece_type::black}) {
 		brds[1] = brds[2] = 0;
 		avl[1] = avl[2] = board_mask;
 	}
 	// board(const grid& b, const data& d) : stone(b), attr(d) {}
-	board(const board& b) = default;
-	board& operator =(const board& b) = default;
-
-	struct point {
-		int x, y, i;
-		point(int i = -1) : x(i != -1 ? i / size_y : -1), y(i != -1 ? i % size_y : -1), i(i) {}
-		point(int x, int y) : x(x), y(y), i(x != -1 && y != -1 ? x * size_y + y : -1) {}
-		point(const std::string& name) : point(
-			name.size() >= 2 && name != "PASS" ? name[0] - (name[0] > 'I' ? 'B' : 'A') : -1,
-			name.size() >= 2 && std::isdigit(name[1]) ? std::stoul(name.substr(1)) - 1 : -1) {}
-		point(const char* name) : point(std::string(name)) {}
-		point(const point&) = default;
-		operator std::string() const {
-			if (i == -1) return "PASS";
-			if (x >= size_x || y >= size_y) return "??";
-			return std::string(1, x + (x < 8 ? 'A' : 'B')) + std::to_string(y + 1);
-		}
-	};
+	basic_board_state(const basic_board_state& b) = default;
+	basic_board_state& operator =(const basic_board_state& b) = default;
 
 	piece_type operator()(int x, int y) const {
-		return operator()(x * 9 + y);
+		return operator()(x * size_y + y);
 	}
 	piece_type operator()(int i) const {
 		return operator()(shifted(i));
 	}
-	piece_type operator()(uint128 v) const {
+	piece_type operator()(bitboard v) const {
 		if (v & brds[1]) return piece_type::black;
 		if (v & brds[2]) return piece_type::white;
 		if (v & hollow_mask) return piece_type::hollow;
@@ -109,17 +130,16 @@ public:
 	// cell& operator ()(const std::string& move) { point p(move); return stone[p.x][p.y]; }
 	// const cell& operator ()(const std::string& move) const { point p(move); return stone[p.x][p.y]; }
 
-	// operator grid&() { return stone; }
-	// operator const grid&() const { return stone; }
-	// column& operator [](unsigned x) { return stone[x]; }
-	// const column& operator [](unsigned x) const { return stone[x]; }
-	// cell& operator ()(unsigned i) { point p(i); return stone[p.x][p.y]; }
-	// const cell& operator ()(unsigned i) const { point p(i); return stone[p.x][p.y]; }
-	// cell& operator ()(const std::string& move) { point p(move); return stone[p.x][p.y]; }
-	// const cell& operator ()(const std::string& move) const { point p(move); return stone[p.x][p.y]; }
-
 	data info() const { return attr; }
-	data info(data dat) { data old = attr; attr = dat; return old; }
+	data info(data dat) {
+		data old = attr;
+		if (old.who_take_turns != dat.who_take_turns) key ^= zobrist_turn;
+		attr = dat;
+		return old;
+	}
+
+	// zobrist key of the stones and the side to move
+	uint64_t hash() const { return key; }
 
 public:
 	// bool operator ==(const board& b) const { return stone == b.stone; }
@@ -129,57 +149,335 @@ public:
 	// bool operator <=(const board& b) const { return !(b < *this); }
 	// bool operator >=(const board& b) const { return !(*this < b); }
 
-	bool operator ==(const board& b) const { return brds[1] == b.brds[1] && brds[2] == b.brds[2]; }
-	bool operator < (const board& b) const { return (brds[1] == b.brds[1])? (brds[2] < b.brds[2]) : (brds[1] < b.brds[1]); }
-	bool operator !=(const board& b) const { return !(*this == b); }
-	bool operator > (const board& b) const { return b < *this; }
-	bool operator <=(const board& b) const { return !(b < *this); }
-	bool operator >=(const board& b) const { return !(*this < b); } 
+	bool operator ==(const basic_board_state& b) const { return key == b.key && brds[1] == b.brds[1] && brds[2] == b.brds[2]; }
+	bool operator < (const basic_board_state& b) const { return (brds[1] == b.brds[1])? (brds[2] < b.brds[2]) : (brds[1] < b.brds[1]); }
+	bool operator !=(const basic_board_state& b) const { return !(*this == b); }
+	bool operator > (const basic_board_state& b) const { return b < *this; }
+	bool operator <=(const basic_board_state& b) const { return !(b < *this); }
+	bool operator >=(const basic_board_state& b) const { return !(*this < b); }
 
 public:
-	// basic uint128 bitoperation 
-	static constexpr uint128 lsb(uint128 v) { return (v & -v); }
-	static constexpr uint128 reset(uint128 v) { return (v & (v - 1)); }
+	// basic bitboard bitoperation
+	static constexpr bitboard lsb(bitboard v) { return ::lsb(v); }
+	static constexpr bitboard reset(bitboard v) { return ::reset(v); }
 
 	// the bit index, ensure v has only one 1 bit
-	static int bit_scan(uint128 v) {
-		int re = 0, step = 64;
-		while (step) {
-			if (v >> step) re += step, v >>= step;
-			step >>= 1;
+	static int bit_scan(bitboard v) { return ::bit_scan(v); }
+
+	static int bit_count(bitboard v) { return ::bit_count(v); }
+
+	// the bit index of the n-th (0-based) 1 bit of v
+	static int nth_one(bitboard v, int n) { return ::nth_one(v, n); }
+
+	// the bitboard with only the i-th bit
+	static constexpr bitboard shifted(int i) { return bitboard(1) << i; }
+
+	static unsigned opponent(unsigned who) {
+		return who ^ 0x3u;
+	}
+
+protected:
+	// helper functions of bitboard
+	static constexpr bitboard shift_up(bitboard v) { return v >> size_y; }
+	static constexpr bitboard shift_down(bitboard v) { return (v << size_y) & board_mask; }
+	static constexpr bitboard shift_right(bitboard v) { return (v << 1) & ~left_mask & board_mask; }
+	static constexpr bitboard shift_left(bitboard v) { return (v >> 1) & ~right_mask; }
+
+	// flow to U, D, L, R one step
+	static constexpr bitboard flow1(bitboard v) { return v | shift_down(v) | shift_left(v) | shift_up(v) | shift_right(v); }
+
+	// i-th bit as bool
+	static constexpr bool bit_ith(bitboard v, int idx) { return bool(v & shifted(idx)); }
+
+public:
+	piece_type at(int x, int y) const {
+		int idx = x * size_y + y;
+		bitboard bb = shifted(idx);
+		if (brds[1] & brds[2]) std::cout << "overlap!\n";
+		if (brds[1] & hollow_mask) std::cout << "overlap black hollow!\n";
+		if (brds[2] & hollow_mask) std::cout << "overlap white hollow!\n";
+		if (bb & brds[1]) return piece_type::black;
+		if (bb & brds[2]) return piece_type::white;
+		if (bb & hollow_mask) return piece_type::hollow;
+		return piece_type::empty;
+	}
+
+	bitboard available() const { return avl[info().who_take_turns]; }
+
+	bitboard available(unsigned who) const {
+		return avl[who];
+	}
+
+	bitboard find_move(const basic_board_state& b) const {
+		auto who = info().who_take_turns;
+		return b.brds[who] ^ brds[who];
+	}
+
+	int find_move_index(const basic_board_state& b) const {
+		return bit_scan(find_move(b));
+	}
+
+public:
+	/**
+	 * the dihedral symmetries of the board, t in [0, symmetries)
+	 * a cell [x][y] is transposed if (t & 4), then x is reflected if (t & 2), then y is reflected if (t & 1),
+	 * a board that is not square only has the first 4
+	 */
+	static constexpr int symmetries = size_x == size_y ? 8 : 4;
+
+	// the index of the cell i after the transform t
+	static constexpr int transform_index(int i, int t) {
+		int x = i / size_y, y = i % size_y;
+		if (t & 4) std::swap(x, y);
+		if (t & 2) x = size_x - 1 - x;
+		if (t & 1) y = size_y - 1 - y;
+		return x * size_y + y;
+	}
+
+	// the transform undoing t
+	static constexpr int inverse(int t) {
+		return (t & 4) ? (4 | (t & 1) << 1 | (t & 2) >> 1) : t;
+	}
+
+	// the bitboard after the transform t, by delta swaps of the rows, the columns, and the diagonals
+	static constexpr bitboard transform(bitboard v, int t) {
+		if (t & 4) v = transpose(v);
+		if (t & 2) v = reflect_x(v);
+		if (t & 1) v = reflect_y(v);
+		return v;
+	}
+
+	// all the transforms of v at once, sharing the transpose and the reflections
+	static constexpr std::array<bitboard, symmetries> transforms(bitboard v) {
+		std::array<bitboard, symmetries> re{};
+		for (int t = 0; t < symmetries; t += 4) {
+			re[t] = t ? transpose(v) : v;
+			re[t | 2] = reflect_x(re[t]);
+			re[t | 1] = reflect_y(re[t]);
+			re[t | 3] = reflect_y(re[t | 2]);
 		}
 		return re;
 	}
 
-	static int bit_count(uint128 v) {
-		const constexpr uint128 flt1 = make_uint128(0x5555555555555555, 0x5555555555555555);
-		const constexpr uint128 flt2 = make_uint128(0x3333333333333333, 0x3333333333333333);
-		const constexpr uint128 flt3 = make_uint128(0x0f0f0f0f0f0f0f0f, 0x0f0f0f0f0f0f0f0f);
-		const constexpr uint128 mul  = make_uint128(0x0101010101010101, 0x0101010101010101);
-		// const constexpr uint128 flt4 = make_uint128(0x00ff00ff00ff00ff, 0x00ff00ff00ff00ff);
-		// const constexpr uint128 flt5 = make_uint128(0x0000ffff0000ffff, 0x0000ffff0000ffff);
-		v = ((v & flt1)) + ((v >> 1) & flt1);
-		v = ((v & flt2)) + ((v >> 2) & flt2);
-		v = ((v & flt3)) + ((v >> 4) & flt3);
-		return (v * mul) >> 120;
+	// the state after the transform t, the stones and the available moves are moved together
+	basic_board_state transformed(int t) const {
+		basic_board_state s(*this);
+		for (unsigned who = 1; who <= 2; ++who) {
+			s.brds[who] = transform(brds[who], t);
+			s.avl[who] = transform(avl[who], t);
+		}
+		s.key = stone_key(s.brds) ^ (attr.who_take_turns == piece_type::white ? zobrist_turn : 0);
+		return s;
 	}
 
-private:
-	// helper functions of uint128
-	static constexpr uint128 shift_up(uint128 v) { return v >> 9; }
-	static constexpr uint128 shift_down(uint128 v) { return (v << 9) & board_mask; }
-	static constexpr uint128 shift_right(uint128 v) { return (v << 1) & ~left_mask & board_mask; }
-	static constexpr uint128 shift_left(uint128 v) { return (v >> 1) & ~right_mask; }
+	/**
+	 * the smallest state by operator < among the symmetries, and the transform to it
+	 * a move i in this state is the move transform_index(i, t) in the canonical one
+	 */
+	std::pair<basic_board_state, int> canonical() const {
+		int best = 0;
+		auto t1 = transforms(brds[1]);
+		bitboard b2 = brds[2];
+		for (int t = 1; t < symmetries; ++t) {
+			if (t1[best] < t1[t]) continue;
+			/* the white stones only break the ties of the black stones */
+			bitboard t2 = transform(brds[2], t);
+			if (t1[t] == t1[best] && !(t2 < b2)) continue;
+			b2 = t2, best = t;
+		}
+		return {best ? transformed(best) : *this, best};
+	}
 
-	// flow to U, D, L, R one step
-	static constexpr uint128 flow1(uint128 v) { return v | shift_down(v) | shift_left(v) | shift_up(v) | shift_right(v); }
+protected:
+	static constexpr bitboard delta_swap(bitboard v, bitboard m, int d) {
+		bitboard t = ((v >> d) ^ v) & m;
+		return v ^ t ^ (t << d);
+	}
 
-	// i-th bit as bool
-	static constexpr bool bit_ith(uint128 v, int idx) { return (v >> idx) & 1u;}
+	// x -> size_x - 1 - x, swap the rows from outside in
+	static constexpr bitboard reflect_x(bitboard v) {
+		for (int x = 0; x < size_x / 2; ++x)
+			v = delta_swap(v, reflect_x_masks[x], (size_x - 1 - 2 * x) * size_y);
+		return v;
+	}
+
+	// y -> size_y - 1 - y, swap the columns from outside in
+	static constexpr bitboard reflect_y(bitboard v) {
+		for (int y = 0; y < size_y / 2; ++y)
+			v = delta_swap(v, reflect_y_masks[y], size_y - 1 - 2 * y);
+		return v;
+	}
+
+	// [x][y] -> [y][x] on square boards, swap each diagonal y - x == k with y - x == -k
+	static constexpr bitboard transpose(bitboard v) {
+		for (int k = 1; k < size_y; ++k)
+			v = delta_swap(v, transpose_masks[k], (size_y - 1) * k);
+		return v;
+	}
+
+	// zobrist key of the stones only
+	static uint64_t stone_key(const bitboard* brds) {
+		uint64_t re = 0;
+		for (unsigned who = 1; who <= 2; ++who)
+			for (bitboard v = brds[who]; v; v = reset(v))
+				re ^= zobrist[who][bit_scan(lsb(v))];
+		return re;
+	}
+
+protected:
+	const static constexpr bitboard up_mask     = make_mask<bitboard>(size_x, size_y, [](int x, int y) { return x == 0; }); // 1 wehn uppest row
+	const static constexpr bitboard down_mask   = make_mask<bitboard>(size_x, size_y, [](int x, int y) { return x == size_x - 1; }); // 1 when downest row
+	const static constexpr bitboard left_mask   = make_mask<bitboard>(size_x, size_y, [](int x, int y) { return y == 0; }); // 1 when leftest column
+	const static constexpr bitboard right_mask  = make_mask<bitboard>(size_x, size_y, [](int x, int y) { return y == size_y - 1; }); // 1 when rightest column
+
+	const static constexpr bitboard board_mask  = make_mask<bitboard>(size_x, size_y, [](int x, int y) { return !layout::hollow(x, y, size_x, size_y); }); // 1 when placable
+	const static constexpr bitboard hollow_mask = make_mask<bitboard>(size_x, size_y, [](int x, int y) { return layout::hollow(x, y, size_x, size_y); }); // 1 when hollow
+
+	// 9x9 Hollow NoGo generates the same masks as the original hard-coded ones
+	static_assert([] {
+		if constexpr (size_x == 9 && size_y == 9 && std::is_same_v<layout, hollow_cross>)
+			return up_mask == make_uint128(0, 0x1ff) && down_mask == make_uint128(0x1ff00, 0)
+				&& left_mask == make_uint128(0x100, 0x8040201008040201) && right_mask == make_uint128(0x10080, 0x4020100804020100)
+				&& board_mask == make_uint128(0x1FFF7, 0xFBFFF39FFFBFDFFF) && hollow_mask == make_uint128(0x8, 0x04000C6000402000);
+		return true;
+	}(), "the masks of 9x9 Hollow NoGo should be the original ones");
+
+	// lower halves of the delta swaps of the symmetries, see transform()
+	static constexpr auto reflect_x_masks = [] {
+		std::array<bitboard, size_x / 2> m{};
+		for (int k = 0; k < size_x / 2; ++k) m[k] = make_mask<bitboard>(size_x, size_y, [k](int x, int y) { return x == k; });
+		return m;
+	}();
+	static constexpr auto reflect_y_masks = [] {
+		std::array<bitboard, size_y / 2> m{};
+		for (int k = 0; k < size_y / 2; ++k) m[k] = make_mask<bitboard>(size_x, size_y, [k](int x, int y) { return y == k; });
+		return m;
+	}();
+	static constexpr auto transpose_masks = [] {
+		std::array<bitboard, size_y> m{};
+		if (size_x == size_y)
+			for (int k = 1; k < size_y; ++k) m[k] = make_mask<bitboard>(size_x, size_y, [k](int x, int y) { return y - x == k; });
+		return m;
+	}();
+	static_assert([] {
+		for (int t = 0; t < symmetries; ++t)
+			if (transform(hollow_mask, t) != hollow_mask) return false;
+		return true;
+	}(), "the hollow layout should be symmetric");
+
+	// const static constexpr bitboard debrujin    = make_uint128(0x0106143891634793, 0x2A5CD9D3EAD7B77F);
+
+	// random keys of zobrist hashing by splitmix64, [1]: black, [2]: white
+	static constexpr auto zobrist = [] {
+		std::array<std::array<uint64_t, size_x * size_y>, 3> zob{};
+		uint64_t x = 0x4e6f476f486f6c6cull;
+		for (auto& keys : zob) {
+			for (auto& k : keys) {
+				uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+				k = z ^ (z >> 31);
+			}
+		}
+		return zob;
+	}();
+	static constexpr uint64_t zobrist_turn = zobrist[0][0]; // xor-ed when white to move
+
+	template<class> friend class batch_playout;
+
+	bitboard brds[3]; // [1]: black, [2]: white
+	bitboard avl[3]; // [1]: black's available moves, [2]: white's available moves
+	uint64_t key; // zobrist key, see hash()
+	// grid stone;
+	data attr;
+};
+
+/**
+ * the playable board, board_state with the groups of stones
+ *
+ * stones are kept in a union-find forest, and the liberties of each group are cached at its root,
+ * therefore placing a stone only touches the groups around it instead of flood filling the whole board
+ */
+template<int width, int height, class layout = hollow_cross>
+class basic_board : public basic_board_state<width, height, layout> {
+public:
+	typedef basic_board_state<width, height, layout> board_state;
+	using board_state::size_x, board_state::size_y;
+	using typename board_state::piece_type, typename board_state::data, typename board_state::bitboard;
+	using board_state::lsb, board_state::reset, board_state::bit_scan, board_state::bit_count, board_state::nth_one;
+	using board_state::shifted, board_state::opponent, board_state::info, board_state::at;
+	typedef uint64_t score;
+	typedef int reward;
+
+public:
+	basic_board() : board_state(), grp{}, libs{}, undos(0) {}
+	basic_board(const board_state& state) : board_state(state), grp{}, libs{}, undos(0) { build_groups(); }
+	// board(const grid& b, const data& d) : stone(b), attr(d) {}
+	basic_board(const basic_board& b) = default;
+	basic_board& operator =(const basic_board& b) = default;
+
+	struct point {
+		int x, y, i;
+		point(int i = -1) : x(i != -1 ? i / size_y : -1), y(i != -1 ? i % size_y : -1), i(i) {}
+		point(int x, int y) : x(x), y(y), i(x != -1 && y != -1 ? x * size_y + y : -1) {}
+		point(const std::string& name) : point(
+			name.size() >= 2 && name != "PASS" ? name[0] - (name[0] > 'I' ? 'B' : 'A') : -1,
+			name.size() >= 2 && std::isdigit(name[1]) ? std::stoul(name.substr(1)) - 1 : -1) {}
+		point(const char* name) : point(std::string(name)) {}
+		point(const point&) = default;
+		operator std::string() const {
+			if (i == -1) return "PASS";
+			if (x >= size_x || y >= size_y) return "??";
+			return std::string(1, x + (x < 8 ? 'A' : 'B')) + std::to_string(y + 1);
+		}
+	};
+
+	/**
+	 * the change of a move made by try_place(), reverted by unplace()
+	 * brds and key follow from idx and the side to move in attr
+	 * the records are kept by the caller, e.g., on its stack, so that the board stays trivially copyable
+	 */
+	struct undo {
+		bitboard avl_delta[2]; // xor of avl[1] and avl[2] before and after
+		data attr; // before the move
+		int16_t idx; // the placed cell
+		int16_t merged[4]; // roots of who merged into idx, padded by -1
+		int16_t adjacent[4]; // roots of opp besides idx, which lost the librety idx, padded by -1
+	};
+
+	// operator grid&() { return stone; }
+	// operator const grid&() const { return stone; }
+	// column& operator [](unsigned x) { return stone[x]; }
+	// const column& operator [](unsigned x) const { return stone[x]; }
+	// cell& operator ()(unsigned i) { point p(i); return stone[p.x][p.y]; }
+	// const cell& operator ()(unsigned i) const { point p(i); return stone[p.x][p.y]; }
+	// cell& operator ()(const std::string& move) { point p(move); return stone[p.x][p.y]; }
+	// const cell& operator ()(const std::string& move) const { point p(move); return stone[p.x][p.y]; }
+
+private:
+	using board_state::flow1, board_state::bit_ith;
+	using board_state::board_mask, board_state::hollow_mask, board_state::zobrist, board_state::zobrist_turn;
+	using board_state::brds, board_state::avl, board_state::key, board_state::attr;
+
+	// adjacent placable cells of each cell, padded by -1
+	static constexpr auto neighbors = [] {
+		std::array<std::array<int16_t, 4>, size_x * size_y> nb{};
+		const int dx[] = {-1, 1, 0, 0}, dy[] = {0, 0, -1, 1};
+		for (int i = 0; i < size_x * size_y; ++i) {
+			int x = i / size_y, y = i % size_y, k = 0;
+			for (auto& n : nb[i]) n = -1;
+			for (int d = 0; d < 4; ++d) {
+				int nx = x + dx[d], ny = y + dy[d];
+				if (nx < 0 || nx >= size_x || ny < 0 || ny >= size_y) continue;
+				if (bit_ith(board_mask, nx * size_y + ny)) nb[i][k++] = nx * size_y + ny;
+			}
+		}
+		return nb;
+	}();
 
 	// connected components of center v, boundry brd
-	static uint128 cnnt_comp(uint128 v, uint128 brd) {
-		uint128 v2 = v;
+	static bitboard cnnt_comp(bitboard v, bitboard brd) {
+		bitboard v2 = v;
 		do {
 			v = v2;
 			v2 = flow1(v) & brd;
@@ -190,73 +488,119 @@ private:
 
 
 	// libreties of connected component cc, boundry brd(hollow or oppnent)
-	static uint128 libreties(uint128 cc, uint128 brd) { return ((flow1(cc) ^ cc) | brd) ^ brd; }
+	static bitboard libreties(bitboard cc, bitboard brd) { return ((flow1(cc) ^ cc) | brd) ^ brd; }
 	// return true when v has exactly one 1 bit
-	static bool count_one(uint128 v) { return v == lsb(v); }
+	static bool count_one(bitboard v) { return v == lsb(v); }
+
+	// root of the group containing stone i, with path halving
+	// except while undo records exist, so that unplace() only restores the roots it merged
+	int root(int i) {
+		if (undos) {
+			while (grp[i] != i) i = grp[i];
+			return i;
+		}
+		while (grp[i] != i) i = grp[i] = grp[grp[i]];
+		return i;
+	}
 
-	void update_librety(bitboard bb, int who) {
-		// 3 types of removing available
+	// rebuild the groups from brds, e.g., after converting from a board_state
+	void build_groups() {
+		bitboard emps = (board_mask ^ brds[1]) ^ brds[2];
+		for (bitboard v = brds[1] | brds[2]; v; v = reset(v)) {
+			int i = bit_scan(lsb(v));
+			grp[i] = i;
+			libs[i] = libreties(lsb(v), ~emps);
+		}
+		for (bitboard v = brds[1] | brds[2]; v; v = reset(v)) {
+			int i = bit_scan(lsb(v));
+			bitboard own = bit_ith(brds[1], i) ? brds[1] : brds[2];
+			for (int n : neighbors[i]) {
+				if (n < 0) break;
+				if (!bit_ith(own, n)) continue;
+				int ri = root(i), rn = root(n);
+				if (ri != rn) grp[rn] = ri, libs[ri] |= libs[rn];
+			}
+		}
+	}
+
+	// whether who can place on the empty cell i, by the liberties of adjacent groups
+	bool can_place(int i, unsigned who) {
+		bitboard bb = shifted(i);
+		bool lib = false;
+		for (int n : neighbors[i]) {
+			if (n < 0) break;
+			if (bit_ith(brds[who], n)) lib |= bool(libs[root(n)] & ~bb);
+			else if (bit_ith(brds[opponent(who)], n)) { if (libs[root(n)] == bb) return false; }
+			else lib = true;
+		}
+		return lib;
+	}
+
+	void update_librety(bitboard bb, int idx, int who, undo* rec = nullptr) {
+		// the stone merges with the adjacent groups of who, and takes one librety from the adjacent groups of opp
+		// since there is no capture, an unavailable cell never becomes available again,
+		// so only the cells around the changed groups are checked
 		// 1. remove bb itself from both avl
-		// 2. the connected component of who containing bb remains one librety, say lib
+		// 2. the merged group of who remains one librety, say lib
 		//     remove lib from avl[opp]
 		// 	   remove lib from avl[who] if fill it will be dead
-		// 3. the connected component of opp besides bb remains one librety, say lib
+		// 3. the group of opp besides bb remains one librety, say lib
 		//     remove lib from avl[who]
 		//	   remove lib from avl[opp] if fill it will be dead
-		// 4. the empty besides bb becomes a last librety of opp(eye or last librety)
-		// 	   remove it from avl[opp]
+		// 4. the empty besides bb has no empty neighbor left (eye or last librety)
+		// 	   remove it from avl[opp] if fill it will be dead
 
 		// type 1
 		avl[1] ^= (avl[1] & bb);
 		avl[2] ^= (avl[2] & bb);
-		// type 2
+
 		int opp = opponent(who);
-		{
-			uint128 cc = cnnt_comp(bb, brds[who]);
-			uint128 lib = libreties(cc, brds[opp] | hollow_mask);
-			if (count_one(lib)) {
-				avl[opp] ^= (avl[opp] & lib);
-				if (!libreties(cnnt_comp(cc | lib, brds[who] | lib), brds[opp] | hollow_mask)) {
-					avl[who] ^= (avl[who] & lib);
+		bitboard emps = (board_mask ^ brds[1]) ^ brds[2];
+		bitboard chk_who = 0, chk_opp = 0;
+		grp[idx] = idx;
+		libs[idx] = 0;
+		int merged = 0, adjacent = 0;
+		for (int n : neighbors[idx]) {
+			if (n < 0) break;
+			bitboard nb = shifted(n);
+			if (nb & brds[who]) {
+				int r = root(n);
+				if (r != idx) {
+					grp[r] = idx, libs[idx] |= libs[r];
+					if (rec) rec->merged[merged++] = r;
 				}
 			}
-		}
-		// type 3 and 4
-		uint128 emps = (board_mask ^ brds[1]) ^ brds[2];
-		auto upd = [&](uint128 bb) {
-			if (bb & brds[opp]) {
-				uint128 cc = cnnt_comp(bb, brds[opp]);
-				uint128 lib = libreties(cc, brds[who] | hollow_mask);
-				if (count_one(lib)) {
-					avl[who] ^= (avl[who] & lib);
-					if (!libreties(cnnt_comp(cc | lib, brds[opp] | lib), brds[who] | hollow_mask)) {
-						avl[opp] ^= (avl[opp] & lib);
-					} 
-				} 
-			}
-			if ((bb & emps) && (bb & avl[opp])) {
-				if (!libreties(cnnt_comp(bb, brds[opp] | bb), brds[who] | hollow_mask)) {
-					avl[opp] ^= (avl[opp] & bb);
+			else if (nb & brds[opp]) {
+				int r = root(n);
+				libs[r] &= ~bb;
+				if (rec) rec->adjacent[adjacent++] = r;
+				// type 3
+				if (count_one(libs[r])) {
+					avl[who] ^= (avl[who] & libs[r]);
+					chk_opp |= libs[r];
 				}
 			}
-		};
-		if (!(bb & up_mask)) {
-			uint128 bb_sft = shift_up(bb);
-			upd(bb_sft);
+			else {
+				libs[idx] |= nb;
+				// type 4
+				if (!libreties(nb, ~emps)) chk_opp |= nb;
+			}
 		}
-		if (!(bb & down_mask)) {
-			uint128 bb_sft = shift_down(bb);
-			upd(bb_sft);
-		} 
-		if (!(bb & left_mask)) {
-			uint128 bb_sft = shift_left(bb);
-			upd(bb_sft);
-		} 
-		if (!(bb & right_mask)) {
-			uint128 bb_sft = shift_right(bb);
-			upd(bb_sft);
+		libs[idx] &= ~bb;
+		// type 2
+		if (count_one(libs[idx])) {
+			avl[opp] ^= (avl[opp] & libs[idx]);
+			chk_who |= libs[idx];
 		}
 
+		for (chk_who &= avl[who]; chk_who; chk_who = reset(chk_who)) {
+			bitboard lib = lsb(chk_who);
+			if (!can_place(bit_scan(lib), who)) avl[who] ^= lib;
+		}
+		for (chk_opp &= avl[opp]; chk_opp; chk_opp = reset(chk_opp)) {
+			bitboard lib = lsb(chk_opp);
+			if (!can_place(bit_scan(lib), opp)) avl[opp] ^= lib;
+		}
 	}
 
 public:
@@ -270,19 +614,6 @@ public:
 		illegal_take = reward(-6),
 	};
 
-	piece_type at(int x, int y) const {
-		int idx = x * size_y + y;
-		bitboard bb = 1;
-		bb <<= idx;
-		if (brds[1] & brds[2]) std::cout << "overlap!\n";
-		if (brds[1] & hollow_mask) std::cout << "overlap black hollow!\n";
-		if (brds[2] & hollow_mask) std::cout << "overlap white hollow!\n";
-		if (bb & brds[1]) return piece_type::black;
-		if (bb & brds[2]) return piece_type::white;
-		if (bb & hollow_mask) return piece_type::hollow;
-		return piece_type::empty;
-	}
-
 	void set(int x, int y, piece_type who) {
 
 	}
@@ -292,8 +623,7 @@ public:
 		auto av = avl[info().who_take_turns];
 		if (!av) return std::nullopt;
 		auto idx = std::uniform_int_distribution<>(0, bit_count(av) - 1)(gen);
-		while (idx--) av = reset(av);
-		return bit_scan(lsb(av));
+		return nth_one(av, idx);
 	}
 
 	/**
@@ -325,26 +655,8 @@ public:
 	// 	return place(p.x, p.y, who);
 	// }
 
-	static unsigned opponent(unsigned who) {
-		return who ^ 0x3u;
-	}
-
-	reward place(uint128 bb, unsigned who = piece_type::unknown) {
-		// to check correct role moving
-		if (who == -1u) who = attr.who_take_turns;
-		if (who != attr.who_take_turns) return nogo_move_result::illegal_turn;
-		// to check bb is only one bit
-		// to check bb is on the legal board(on the board and not occupied)
-		if (!(bb & board_mask)) return nogo_move_result::illegal_out_of_range;
-		if ((bb & brds[1]) || (bb & brds[2])) return nogo_move_result::illegal_not_empty;
-		// to check available(not suicide or take)
-		if (!(bb & avl[who])) return nogo_move_result::illegal_suicide;
-		// real place
-		brds[who] |= bb;
-		// TODO update avl
-		update_librety(bb, who);
-		attr.who_take_turns = static_cast<piece_type>(opponent(who));
-		return nogo_move_result::legal;
+	reward place(bitboard bb, unsigned who = piece_type::unknown) {
+		return play(bb, who, nullptr);
 	}
 
 	reward place(int i, unsigned who = piece_type::unknown) {
@@ -362,21 +674,114 @@ public:
 		return place(p.x, p.y, who);
 	}
 
-	uint128 available() const { return avl[info().who_take_turns]; }
+	/**
+	 * place a stone as place(), and record the change in rec if it is legal
+	 * so that a move loop can walk the moves in place instead of copying the board
+	 */
+	reward try_place(int i, undo& rec, unsigned who = piece_type::unknown) {
+		if (i < 0 || i >= size_x * size_y) return nogo_move_result::illegal_out_of_range;
+		rec.avl_delta[0] = avl[1], rec.avl_delta[1] = avl[2];
+		rec.attr = attr;
+		rec.idx = i;
+		std::fill(std::begin(rec.merged), std::end(rec.merged), -1);
+		std::fill(std::begin(rec.adjacent), std::end(rec.adjacent), -1);
+		++undos; // before play(), whose root() calls should not halve the paths through the roots it merges
+		auto re = play(shifted(i), who, &rec);
+		if (re != nogo_move_result::legal) {
+			--undos;
+			return re;
+		}
+		rec.avl_delta[0] ^= avl[1], rec.avl_delta[1] ^= avl[2];
+		return re;
+	}
 
-	uint128 available(unsigned who) const {
-		return avl[who];
+	/**
+	 * revert the move of rec, which should be the last move made by try_place() and not reverted yet
+	 */
+	void unplace(const undo& rec) {
+		unsigned who = rec.attr.who_take_turns;
+		bitboard bb = shifted(rec.idx);
+		brds[who] ^= bb;
+		avl[1] ^= rec.avl_delta[0];
+		avl[2] ^= rec.avl_delta[1];
+		key ^= zobrist[who][rec.idx] ^ zobrist_turn;
+		attr = rec.attr;
+		for (int r : rec.merged) if (r >= 0) grp[r] = r;
+		for (int r : rec.adjacent) if (r >= 0) libs[r] |= bb;
+		--undos;
 	}
 
-	uint128 find_move(const board& b) const {
-		auto who = info().who_take_turns;
-		return b.brds[who] ^ brds[who];
+	// number of moves made by try_place() and not reverted yet
+	std::size_t depth() const { return undos; }
+
+	/**
+	 * whether the rest of the moves are independent, i.e., a move never makes another move illegal
+	 *
+	 * an empty cell that no side can play stays empty since legality is monotone, i.e., a librety forever,
+	 * and a group with such a librety is anchored; the moves are independent when no move is legal for both sides,
+	 * every move is next to such a librety or an anchored group of its side, and so is every group next to a move
+	 */
+	bool independent() {
+		if (avl[1] & avl[2]) return false;
+		bitboard dead = board_mask & ~brds[1] & ~brds[2] & ~avl[1] & ~avl[2];
+		for (unsigned who = 1; who <= 2; ++who) {
+			for (bitboard v = avl[who]; v; v = reset(v)) {
+				bool anchored = false;
+				for (int n : neighbors[bit_scan(lsb(v))]) {
+					if (n < 0) break;
+					if (bit_ith(dead, n)) anchored = true;
+					else if (bit_ith(brds[who], n)) anchored |= bool(libs[root(n)] & dead);
+					else if (bit_ith(brds[opponent(who)], n) && !(libs[root(n)] & dead)) return false;
+				}
+				if (!anchored) return false;
+			}
+		}
+		return true;
 	}
 
-	int find_move_index(const board& b) const {
-		return bit_scan(find_move(b));
+	/**
+	 * finish a random playout at once if the rest of the moves are independent, see independent()
+	 * then the side to move loses if it has no more moves than the opponent, the loser plays all its moves,
+	 * and the winner plays as many moves chosen at random, one more if it moves first
+	 * returns the winner and the moves of both sides in moves[1] and moves[2],
+	 * or piece_type::empty and leaves moves untouched if the moves are not independent
+	 */
+	piece_type settle(std::default_random_engine& gen, bitboard moves[3]) {
+		if (!independent()) return piece_type::empty;
+		unsigned who = attr.who_take_turns;
+		unsigned win = bit_count(avl[who]) <= bit_count(avl[opponent(who)]) ? opponent(who) : who, lose = opponent(win);
+		moves[lose] = avl[lose];
+		moves[win] = 0;
+		bitboard rest = avl[win];
+		for (int n = bit_count(avl[lose]) + (win == who); n--; ) {
+			bitboard mv = shifted(nth_one(rest, std::uniform_int_distribution<>(0, bit_count(rest) - 1)(gen)));
+			moves[win] |= mv;
+			rest ^= mv;
+		}
+		return piece_type(win);
 	}
 
+protected:
+	reward play(bitboard bb, unsigned who, undo* rec) {
+		// to check correct role moving
+		if (who == -1u) who = attr.who_take_turns;
+		if (who != attr.who_take_turns) return nogo_move_result::illegal_turn;
+		// to check bb is only one bit
+		// to check bb is on the legal board(on the board and not occupied)
+		if (!(bb & board_mask)) return nogo_move_result::illegal_out_of_range;
+		if ((bb & brds[1]) || (bb & brds[2])) return nogo_move_result::illegal_not_empty;
+		// to check available(not suicide or take)
+		if (!(bb & avl[who])) return nogo_move_result::illegal_suicide;
+		// real place
+		int idx = bit_scan(bb);
+		brds[who] |= bb;
+		key ^= zobrist[who][idx] ^ zobrist_turn;
+		update_librety(bb, idx, who, rec);
+		attr.who_take_turns = static_cast<piece_type>(opponent(who));
+		return nogo_move_result::legal;
+	}
+
+public:
 	/**
 	 * calculate the liberty of the block of piece at [x][y]
 	 * return >= 0 if [x][y] is placed by who; otherwise return -1
@@ -471,11 +876,11 @@ public:
 		}
 	}
 
-	static void show(uint128 v) {
+	static void show(bitboard v) {
 		for (unsigned int i = 0; i < size_x; ++i) {
 			for (unsigned int j = 0; j < size_y; ++j) {
 				int idx = i * size_y + j;
-				int val = (v >> idx) & 1;
+				int val = bit_ith(v, idx);
 				std::cout << (".O"[val]);
 			}
 			std::cout << '\n';
@@ -490,8 +895,8 @@ public:
 		show(avl[2]);
 	}
 
-	std::array<std::array<int, 9>, 9> to_array() {
-		std::array<std::array<int, 9>, 9> re;
+	std::array<std::array<int, size_y>, size_x> to_array() {
+		std::array<std::array<int, size_y>, size_x> re;
 		for (int i = 0; i < size_x; ++i) {
 			for (int j = 0; j < size_y; ++j) {
 				re[i][j] = at(i, j);
@@ -500,7 +905,7 @@ public:
 		return re;
 	}
 
-	using barr = std::array<std::array<int, 9>, 9>;
+	using barr = std::array<std::array<int, size_y>, size_x>;
 	int check_lib(const barr& arr, int sx, int sy) {
 		int dx[] = {1, 0, -1, 0}, dy[] = {0, 1, 0, -1};
 		auto a = arr;
@@ -605,11 +1010,11 @@ public:
 					}
 				}
 			}
-			for (uint128 v = avl[who]; v; v = reset(v)) {
+			for (bitboard v = avl[who]; v; v = reset(v)) {
 				vec.push_back(bit_scan(v));
 			}
 			std::shuffle(vec.begin(), vec.end(), gen);
-			uint128 bb = 1;
+			bitboard bb = 1;
 			bb <<= vec[0];
 			int x = vec[0] / size_y, y = vec[0] % size_y;
 			std::cout << " BW"[who] << " place " << x << ' ' << y << '\n';
@@ -633,7 +1038,7 @@ public:
 public:
 	
 
-	friend std::ostream& operator <<(std::ostream& out, const board& b) {
+	friend std::ostream& operator <<(std::ostream& out, const basic_board& b) {
 		std::cout << "outputboard\n";
 		std::ios ff(nullptr);
 		ff.copyfmt(out); // make a copy of the original print format
@@ -708,18 +1113,34 @@ protected:
 	// 	stone[7][4] = piece_type::hollow;
 	// }
 private:
-	const static constexpr bitboard up_mask     = make_uint128(0,0x1ff); // 1 wehn uppest row
-	const static constexpr bitboard down_mask   = make_uint128(0x1ff00,0); // 1 when downest row
-	const static constexpr bitboard left_mask   = make_uint128(0x100,0x8040201008040201); // 1 when leftest column
-	const static constexpr bitboard right_mask  = make_uint128(0x10080,0x4020100804020100); // 1 when rightest column
-
-	const static constexpr bitboard board_mask  = make_uint128(0x1FFF7,0xFBFFF39FFFBFDFFF); // 1 when placable
-	const static constexpr bitboard hollow_mask = make_uint128(0x8,0x04000C6000402000); // 1 when hollow
-
-	// const static constexpr bitboard debrujin    = make_uint128(0x0106143891634793, 0x2A5CD9D3EAD7B77F);
+	std::conditional_t<(size_x * size_y < 256), uint8_t, uint16_t> grp[size_x * size_y]; // parent of each stone in the union-find, grp[i] == i for the root
+	std::array<bitboard, size_x * size_y> libs; // libreties of each group, only valid at the root
+	uint16_t undos; // moves made by try_place() and not reverted yet
+};
 
-	bitboard brds[3]; // [1]: black, [2]: white
-	bitboard avl[3]; // [1]: black's available moves, [2]: white's available moves
-	// grid stone;
-	data attr;
+/**
+ * hash by the zobrist key, for unordered containers of positions
+ */
+namespace std {
+template<int width, int height, class layout> struct hash<basic_board_state<width, height, layout>> {
+	size_t operator()(const basic_board_state<width, height, layout>& b) const { return b.hash(); }
 };
+template<int width, int height, class layout> struct hash<basic_board<width, height, layout>> {
+	size_t operator()(const basic_board<width, height, layout>& b) const { return b.hash(); }
+};
+}
+
+/**
+ * the board used by the program, 9x9 Hollow NoGo by default
+ * other variants are built by, e.g., make BOARD_SIZE=13 BOARD_HOLLOW=0
+ */
+#ifndef BOARD_SIZE
+#define BOARD_SIZE 9
+#endif
+#ifndef BOARD_HOLLOW
+#define BOARD_HOLLOW 1
+#endif
+typedef std::conditional_t<BOARD_HOLLOW, hollow_cross, hollow_none> board_layout;
+typedef basic_board_state<BOARD_SIZE, BOARD_SIZE, board_layout> board_state;
+typedef basic_board<BOARD_SIZE, BOARD_SIZE, board_layout> board;
+static_assert(std::is_trivially_copyable_v<board>, "the board is copied by every playout");
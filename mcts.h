@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <unordered_set>
@@ -11,10 +12,27 @@
 #include <algorithm>
 
 #include "agent.h"
+#include "playout.h"
+#include "pattern.h"
+#include "workers.h"
 
 // #define DEMO
 
+/*
+	avx2 selection is compiled on gcc x86_64 and picked at runtime by cpu detection
+	it loads the statistics by plain vector loads, which tsan reports, so tsan builds select in scalar
+*/
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__SANITIZE_THREAD__)
+#include <immintrin.h>
+#define MCTS_SELECT_AVX2
+#define MCTS_SELECT_TARGET __attribute__((target("avx2")))
+inline bool avx2_select = __builtin_cpu_supports("avx2");
+#else
+inline bool avx2_select = false;
+#endif
+
 class mcts : public agent {
+	friend class trainer; // searches the training positions by tree
 public:
 	mcts(const std::string& args = "") : agent("role=unknown " + args + " name=mcts") {
 		assign("thread_size", thread_size);
@@ -27,7 +45,41 @@ public:
 		assign("c_time", c_time);
 		assign("max_ply", max_ply);
 		assign("max_ply_mul", max_ply_mul);
+		assign("time_extend", time_extend);
+		assign("time_margin", time_margin);
+		assign("early_c", early_c);
+		assign("early_z", early_z);
+		assign("bank", bank);
+		assign("batch", batch);
+		assign("settle", tre.settle);
+		assign("vloss", tre.vloss);
+		assign("fpu", tre.fpu);
+		assign("pw_c", tre.pw_c);
+		assign("pw_alpha", tre.pw_alpha);
+		batch = std::clamp<std::size_t>(batch, 1, playout::max_lanes);
+		if (!playout::vectorized()) batch = 1; // the batches only pay off by the avx2 kernel, see playout.h
 		if (meta.find("demo") != meta.end()) demo = true;
+		if (meta.find("parallel") != meta.end()) {
+			std::string mode = meta["parallel"];
+			if (mode != "tree" && mode != "root") throw std::invalid_argument("invalid parallel: " + mode);
+			root_parallel = mode == "root";
+		}
+		assign("tt", tt);
+		if (meta.find("tt_replace") != meta.end()) {
+			std::string policy = meta["tt_replace"];
+			if (policy != "visits" && policy != "always") throw std::invalid_argument("invalid tt_replace: " + policy);
+			tt_replace = policy == "visits" ? pool::replace::visits : pool::replace::always;
+		}
+		if (meta.find("early") != meta.end()) {
+			std::string mode = meta["early"];
+			if (mode != "off" && mode != "visits" && mode != "bound") throw std::invalid_argument("invalid early: " + mode);
+			early_stop = mode == "off" ? early::off : mode == "visits" ? early::visits : early::bound;
+		}
+		if (meta.find("widen") != meta.end()) {
+			std::string mode = meta["widen"];
+			if (mode != "all" && mode != "fpu" && mode != "pw") throw std::invalid_argument("invalid widen: " + mode);
+			tre.widening_mode = mode == "all" ? tree::widening::all : mode == "fpu" ? tree::widening::fpu : tree::widening::pw;
+		}
 		if (meta.find("stat") != meta.end()) {
 			stat = true;
 			stat_out.open(meta["stat"], std::ios_base::app);
@@ -40,22 +92,39 @@ public:
 		gens.resize(thread_size);
 		std::random_device rd;
 		for (auto& gen : gens) gen.seed(rd());
+		assign("pin", pin);
+		searchers.spawn(thread_size, pin);
+
+		/*
+			the memory budget replaces reserve and reserve_main, it is split evenly among the pools,
+			each pool keeps a node for every edges_per_node edges, since most nodes have tens of edges
+		*/
+		assign("memory", memory);
+		std::size_t nodes = 0;
+		if (memory) {
+			std::size_t pools = root_parallel ? thread_size + 1 : 1, share = (memory << 20) / pools;
+			std::size_t unit = pool::edge_bytes * edges_per_node + pool::node_bytes; // the bytes of a node and its edges
+			if (share <= pool::bytes(0, tt) + unit) throw std::invalid_argument("memory is too small: " + std::to_string(memory));
+			nodes = (share - pool::bytes(0, tt)) / unit;
+			reserve = reserve_main = nodes * edges_per_node;
+		}
 
 		bufs.resize(thread_size);
-		for (auto& buf : bufs) buf.reserve(reserve);
+		if (root_parallel) for (auto& buf : bufs) buf.reserve(reserve, tt, tt_replace, nodes);
 		// buf_main.reserve(reserve);
+		buf_main.reserve(reserve_main, tt, tt_replace, nodes);
 
 		/*
-			simulation balancing
+			the heavy playouts by the weights of weight.bin, which are not batched
 		*/
-		// if (meta.find("load") != meta.end()) tre.load_weight(meta["load"]);
+		if (meta.find("load") != meta.end()) {
+			tre.heavy = std::make_shared<const heavy_playout>(heavy_playout::load(meta["load"]));
+			batch = 1;
+		}
 	}
 
 	~mcts() {
-		/*
-			simulation balancing
-		*/
-		// if (meta.find("save") != meta.end()) tre.save_weight(meta["save"]);
+		end_after_mcts();
 
 		/*
 			stat
@@ -64,138 +133,322 @@ public:
 	}
 
 protected:
-	class node : public board {
+	/*
+		the search trees, kept in arrays and referenced by 32-bit indices
+
+		an edge is a move with its statistics, and leads to a node once it is expended
+		a node is a position, whose edges are a contiguous range allocated at once on its second visit,
+		and claimed in order, one by each simulation, through next
+		the edges are ordered by a cheap prior, the moves the opponent can also play come first,
+		so that widening the node slowly, see tree::widening, searches the likely moves deeper
+		the boards are not kept, they are replayed from the root on the way down
+
+		with the transposition table, the edges reaching the same position share one node,
+		so the tree becomes a DAG, and a node counts the visits from all of its edges in total
+
+		the edges proven to win or lose by the solver are kept in proofs, which are final once set
+
+		the trees are reused in place, a node is released once no edge links to it,
+		and its edges are kept in the free list of their size for the nodes allocated later
+
+		the threads searching the same tree share its pool, the shared values are accessed by std::atomic_ref
+	*/
+	class pool {
 	public:
-		node(const board& state) : board(state), child(bit_count(state.available()), nullptr) {}
+		using index = uint32_t;
+		static constexpr index none = 0; // no node, or the root edge, which is never a child
+		static constexpr index busy = -1; // the node is being expended by another thread
+		enum class replace { visits, always }; // which entry of a full bucket a new node replaces
 
 	public:
+		pool(std::size_t capacity = 0, std::size_t table_mb = 0, replace policy = replace::visits) {
+			reserve(capacity, table_mb, policy);
+		}
+
+		/*
+			allocate the storage of capacity edges and node_capacity nodes (capacity if 0),
+			and the table of table_mb MB, the nodes are dropped
+		*/
+		void reserve(std::size_t capacity, std::size_t table_mb = 0, replace policy = replace::visits, std::size_t node_capacity = 0) {
+			cap = std::min<std::size_t>(capacity, busy);
+			node_cap = std::min<std::size_t>(node_capacity ? node_capacity : capacity, busy);
+			wins = std::make_unique_for_overwrite<int[]>(cap);
+			visits = std::make_unique_for_overwrite<int[]>(cap);
+			rave_wins = std::make_unique_for_overwrite<int[]>(cap);
+			rave_visits = std::make_unique_for_overwrite<int[]>(cap);
+			moves = std::make_unique_for_overwrite<uint16_t[]>(cap);
+			nodes = std::make_unique_for_overwrite<index[]>(cap);
+			proofs = std::make_unique_for_overwrite<int8_t[]>(cap);
+			firsts = std::make_unique_for_overwrite<index[]>(node_cap);
+			counts = std::make_unique_for_overwrite<uint16_t[]>(node_cap);
+			nexts = std::make_unique_for_overwrite<uint16_t[]>(node_cap);
+			totals = std::make_unique_for_overwrite<int[]>(node_cap);
+			keys = std::make_unique_for_overwrite<uint64_t[]>(node_cap);
+			spans = std::make_unique_for_overwrite<uint16_t[]>(node_cap);
+			refs = std::make_unique_for_overwrite<int[]>(node_cap);
+			links = std::make_unique_for_overwrite<index[]>(node_cap);
+			heads.assign(board::size_x * board::size_y + 1, none);
+
+			table = table_mb ? std::make_unique<bucket[]>(buckets(table_mb)) : nullptr;
+			mask = buckets(table_mb) - 1;
+			this->policy = policy;
+			clear();
+		}
+
+		/*
+			the bytes taken by the storage of reserve()
+		*/
+		static constexpr std::size_t edge_bytes = 4 * sizeof(int) + sizeof(uint16_t) + sizeof(index) + sizeof(int8_t);
+		static constexpr std::size_t node_bytes = 2 * sizeof(index) + 3 * sizeof(uint16_t) + 2 * sizeof(int) + sizeof(uint64_t);
+		static std::size_t bytes(std::size_t capacity, std::size_t table_mb = 0, std::size_t node_capacity = 0) {
+			return capacity * edge_bytes + (node_capacity ? node_capacity : capacity) * node_bytes + (table_mb ? buckets(table_mb) * sizeof(bucket) : 0);
+		}
+
+		/*
+			drop all nodes, only the root edge is kept
+		*/
+		void clear() {
+			used = 1, node_used = 1, freed = 0, misses = 0;
+			std::fill(heads.begin(), heads.end(), none);
+			if (table) std::fill(table.get(), table.get() + mask + 1, bucket{});
+		}
+		std::size_t size() const { return std::min(used, cap); } // only when no thread runs on the pool
+		std::size_t node_size() const { return std::min(node_used, node_cap) - freed; }
+		std::size_t capacity() const { return cap; }
+
+		/*
+			the allocations failed since the last call, the pool is exhausted if any
+		*/
+		std::size_t exhausted() { return std::atomic_ref(misses).exchange(0, std::memory_order_relaxed); }
+		bool full() { return std::atomic_ref(misses).load(std::memory_order_relaxed) != 0; }
+
+		/*
+			allocate n edges in a row, return std::nullopt if the pool is full
+		*/
+		std::optional<index> allocate(std::size_t n) {
+			auto at = std::atomic_ref(used).fetch_add(n, std::memory_order_relaxed);
+			if (at + n > cap) return std::nullopt;
+			return at;
+		}
+
 		/*
-			return the nullptr node to expend 
-			return std::nullopt if all children are visited
-		*/
-		std::optional<node*> expend(std::vector<node>& buf) {
-			if (buf.capacity() == buf.size()) return std::nullopt;
-			auto av = available();
-			for (auto i = 0u; i < child.size(); ++i, av = reset(av)) {
-				if (child[i] == nullptr) {
-					board brd = *this;
-					brd.place(lsb(av));
-					// auto sz = buf.capacity();
-					buf.push_back(node(brd));
-					// if (buf.capacity() != sz) std::cout << "cap!" << buf.size() << std::endl;
-					return child[i] = &buf.back();
+			allocate a node and its n edges, return none if the pool is full
+			a released node whose edges are at least n is taken first, the free lists are only pushed by release(),
+			which runs alone, so that popping them by compare-and-swap is safe from ABA
+		*/
+		index allocate_node(std::size_t n) {
+			index at = none;
+			for (auto span = n; span < heads.size() && at == none; ++span) {
+				std::atomic_ref head(heads[span]);
+				at = head.load(std::memory_order_acquire);
+				while (at != none && !head.compare_exchange_weak(at, links[at], std::memory_order_acquire));
+			}
+			if (at != none) std::atomic_ref(freed).fetch_sub(1, std::memory_order_relaxed);
+			else {
+				/*
+					no edges are taken once the nodes run out, or each failed expansion would lose its edges,
+					then the edges before the node, a node taken without them would be counted by node_size() but never linked,
+					so that only the threads racing past the last node lose their edges
+				*/
+				if (std::atomic_ref(node_used).load(std::memory_order_relaxed) >= node_cap) {
+					std::atomic_ref(misses).fetch_add(1, std::memory_order_relaxed);
+					return none;
+				}
+				auto re = allocate(n);
+				if (re) at = std::atomic_ref(node_used).fetch_add(1, std::memory_order_relaxed);
+				if (!re || at >= node_cap) {
+					std::atomic_ref(misses).fetch_add(1, std::memory_order_relaxed);
+					return none;
 				}
+				firsts[at] = *re, spans[at] = n;
 			}
-			return std::nullopt;
+			counts[at] = n, nexts[at] = 0;
+			total(at).store(0, std::memory_order_relaxed);
+			ref(at).store(1, std::memory_order_relaxed);
+			return at;
 		}
 
-		bool proceedable() const {
-			return child.size() != 0;
+		/*
+			drop a link to the node, and release it and its subtree once no edge links to it
+			**ENSURE** no thread runs on the pool
+		*/
+		void release(index nd) {
+			if (--refs[nd] > 0) return;
+			for (auto e = firsts[nd]; e < firsts[nd] + counts[nd]; ++e)
+				if (nodes[e] != none) release(nodes[e]);
+			keys[nd] = 0; // the entries of the table to nd are stale
+			totals[nd] = 0;
+			links[nd] = heads[spans[nd]], heads[spans[nd]] = nd;
+			++freed;
 		}
 
-		bool fully_visited() const {
-			return child.back() != nullptr;
+		void init(index e, int mv) {
+			wins[e] = visits[e] = rave_wins[e] = rave_visits[e] = 0;
+			moves[e] = mv, nodes[e] = none, proofs[e] = 0;
 		}
 
-		node* select(float c = 0.1, float k = 10.0) {
-			return *std::max_element(child.begin(), child.end(), [&](node* a, node* b) {
-				return a->score(visit, c, k) < b->score(visit, c, k);
-			});
+		/*
+			expend the edge e to the node of brd, and return the node
+			the node found in the table is shared, otherwise a new one is allocated with an edge for each move
+			return none if the pool is full, or busy if another thread is expending e
+		*/
+		index expend(index e, const board& brd) {
+			index at = none;
+			if (!node(e).compare_exchange_strong(at, busy, std::memory_order_acquire)) return at;
+			auto key = brd.hash();
+			if (auto nd = find(key)) {
+				++ref(nd);
+				node(e).store(nd, std::memory_order_release);
+				return nd;
+			}
+			auto av = brd.available();
+			auto nd = allocate_node(board::bit_count(av));
+			if (nd == none) {
+				node(e).store(none, std::memory_order_relaxed);
+				return none;
+			}
+			/* the moves only we can play are our safe points, filling them is seldom urgent */
+			auto own = av & ~brd.available(board::opponent(brd.info().who_take_turns));
+			auto ch = firsts[nd];
+			for (auto v = av & ~own; v; ++ch, v = board::reset(v)) init(ch, board::bit_scan(board::lsb(v)));
+			for (auto v = own; v; ++ch, v = board::reset(v)) init(ch, board::bit_scan(board::lsb(v)));
+			std::atomic_ref(keys[nd]).store(key, std::memory_order_release);
+			node(e).store(nd, std::memory_order_release);
+			insert(key, nd);
+			return nd;
 		}
 
-		float score(int par_visit, float c = 0.1, float k = 10.0) const {
-			float exploit = float(win) / visit;
-			float rave_exploit = float(rave_win) / rave_visit;
-			float beta = std::sqrt(k / (3 * visit + k));
-			float explore = std::sqrt(std::log(par_visit) / visit);
-			// return -exploit + c * explore; 
-			return (beta - 1) * exploit - beta * rave_exploit + c * explore;
+	protected:
+		/*
+			the table is made of buckets of 4 entries,
+			an entry keeps the high 32 bits of the key and the node, and 0 if empty
+		*/
+		struct bucket { uint64_t entry[4] = {}; };
+		static std::size_t buckets(std::size_t table_mb) {
+			std::size_t n = 1;
+			while (n * 2 * sizeof(bucket) <= (table_mb << 20)) n *= 2;
+			return n;
 		}
 
-		std::optional<action> find_best_order(std::size_t ith, float k = 10.0) const {
-			/*
-				sort the moves from root
-			*/
-			if (child.size() <= ith) return std::nullopt;
-			std::vector<std::pair<int, int>> con;
-			for (auto i = 0u; i < child.size(); ++i) con.push_back({(child[i] == nullptr? 0 : -child[i]->visit), i});
-			// for (auto i = 0u; i < child.size(); ++i) con.push_back({child[i] == nullptr? 1 : float(child[i]->win) / child[i]->visit, i});
-			// for (auto i = 0u; i < child.size(); ++i) con.push_back({child[i] == nullptr? 0 : -child[i]->raved_visit(visit, k), i});
-			std::partial_sort(con.begin(), con.begin() + ith + 1, con.end());
-			// std::sort(con.begin(), con.end());
-			if (child[con[ith].second] == nullptr) return std::nullopt;
-			// std::cout << "fbo " << ith << ' ' << con[ith].first << ' ' << con[ith].second << '\n';
-			return action::place(board::bit_scan(find_move(*child[con[ith].second])), info().who_take_turns);
+		index find(uint64_t key) const {
+			if (!table) return none;
+			for (auto& entry : table[key & mask].entry) {
+				uint64_t v = std::atomic_ref(entry).load(std::memory_order_acquire);
+				if (v && (v >> 32) == (key >> 32) && std::atomic_ref(keys[index(v)]).load(std::memory_order_acquire) == key) return index(v);
+			}
+			return none;
 		}
 
-		std::size_t get_index(action mv) const {
-			for (auto i = 0u; i < child.size(); ++i) {
-				if (child[i] == nullptr) continue;
-				board brd = *this;
-				mv.apply(brd);
-				if (brd == static_cast<board>(*child[i])) return i;
+		void insert(uint64_t key, index nd) {
+			if (!table) return;
+			auto& entry = table[key & mask].entry;
+			auto slot = (key >> 32) & 3;
+			if (policy == replace::visits) {
+				/* an empty entry, or the one whose node has the fewest visits */
+				int fewest = std::numeric_limits<int>::max();
+				for (auto i = 0u; i < 4; ++i) {
+					uint64_t v = std::atomic_ref(entry[i]).load(std::memory_order_acquire);
+					if (!v) {
+						slot = i;
+						break;
+					}
+					if (int vst = total(index(v)); vst < fewest) fewest = vst, slot = i;
+				}
 			}
-			return child.size();
+			std::atomic_ref(entry[slot]).store((key >> 32 << 32) | nd, std::memory_order_release);
 		}
 
 	public:
-		int win = 0, visit = 0;
-		int rave_win = 0, rave_visit = 0;
-		std::vector<node*> child;
+		std::atomic_ref<int> win(index e) const { return std::atomic_ref(wins[e]); }
+		std::atomic_ref<int> visit(index e) const { return std::atomic_ref(visits[e]); }
+		std::atomic_ref<int> rave_win(index e) const { return std::atomic_ref(rave_wins[e]); }
+		std::atomic_ref<int> rave_visit(index e) const { return std::atomic_ref(rave_visits[e]); }
+		std::atomic_ref<index> node(index e) const { return std::atomic_ref(nodes[e]); }
+		std::atomic_ref<uint16_t> next(index nd) const { return std::atomic_ref(nexts[nd]); }
+		std::atomic_ref<int> total(index nd) const { return std::atomic_ref(totals[nd]); }
+		std::atomic_ref<int> ref(index nd) const { return std::atomic_ref(refs[nd]); }
+		std::atomic_ref<int8_t> proof(index e) const { return std::atomic_ref(proofs[e]); }
+
+	public:
+		/*
+			edges
+		*/
+		std::unique_ptr<int[]> wins, visits;
+		std::unique_ptr<int[]> rave_wins, rave_visits;
+		std::unique_ptr<uint16_t[]> moves; // the move of the edge
+		std::unique_ptr<index[]> nodes; // the node led to, none if not expended
+		std::unique_ptr<int8_t[]> proofs; // 1 if the move is proven to win, -1 to lose, 0 if unknown, see tree::update()
+
+		/*
+			nodes, which are fixed once published except next and total
+		*/
+		std::unique_ptr<index[]> firsts; // the first edge
+		std::unique_ptr<uint16_t[]> counts, nexts; // the number of edges, and of the claimed ones
+		std::unique_ptr<int[]> totals; // the visits from all edges
+		std::unique_ptr<uint64_t[]> keys; // the hash of the position, 0 once released
+		std::unique_ptr<uint16_t[]> spans; // the number of edges allocated, at least counts
+		std::unique_ptr<int[]> refs; // the number of edges linking to the node
+		std::unique_ptr<index[]> links; // the next node in the free list
+
+		std::size_t used = 1, node_used = 1, freed = 0, cap = 0, node_cap = 0;
+		std::size_t misses = 0; // the allocations failed, see exhausted()
+		std::vector<index> heads; // the free lists of the released nodes by spans
+		std::unique_ptr<bucket[]> table;
+		std::size_t mask = 0;
+		replace policy = replace::visits;
 	};
 
 	class tree {
 	public:
 		tree() = default;
 
-		using rave_array = std::array<std::array<bool, 81>, 2>;
+		using rave_array = std::array<board::bitboard, 2>; // the moves of black and white during a simulation, for amaf
+		using index = pool::index;
+		static constexpr index root = 0;
+
+		/*
+			when a node claims its next edge instead of selecting among the claimed ones
+			all: every edge is claimed before any is selected
+			fpu: first-play urgency, claim the next edge unless a claimed one scores above fpu
+			pw: progressive widening, claim the next edge while fewer than pw_c * total^pw_alpha are claimed
+		*/
+		enum class widening { all, fpu, pw };
 
 	public:
-		void run_mcts(std::size_t N, std::default_random_engine& gen, std::vector<node>& buf, float c, float k) {
-			for (auto i = 0u; i < N; ++i) {
-			// while (alive) {
-				auto path{select_expend(buf, c, k)};
-				rave_array ra;
-				update(path, simulate(*path.back(), gen, ra), ra);
-				// update(path, simulate_weight(*path.back(), gen, ra), ra);
+		/*
+			run simulations until alive is cleared, mcts::think() decides when
+		*/
+		void run_mcts(const std::atomic<bool>& alive, std::default_random_engine& gen, pool& buf, float c, float k, std::size_t batch = 1) {
+			while (alive) {
+				if (batch > 1) run_batch(batch, gen, buf, c, k);
+				else {
+					board brd;
+					auto path{select_expend(buf, brd, c, k)};
+					rave_array ra = {};
+					update(buf, path, simulate(brd, gen, ra), ra);
+				}
 				/*
-					EARLY-C
+					EARLY-C is checked by mcts::think(), which knows the throughput of all threads
 				*/
-				if (8 * i > N && i % 100 == 0) {
-					auto mv1 = root->find_best_order(0), mv2 = root->find_best_order(1);
-					if (!mv1 || !mv2) return;
-					auto idx1 = root->get_index(*mv1), idx2 = root->get_index(*mv2);
-					// auto vst1 = root->child[idx1]->raved_visit(root->visit, k), vst2 = root->child[idx2]->raved_visit(root->visit, k);
-					auto vst1 = root->child[idx1]->visit, vst2 = root->child[idx2]->visit;
-					// if (vst2 + (N - i - 1) * 0.5 < vst1) {
-					// 	for (auto i = 0u; i < root->child.size(); ++i) {
-					// 		if (root->child[i] != nullptr) std::cout << root->child[i]->visit << '\n';
-					// 	}
-					// 	std::cout << "vst " << vst1 << ' ' << vst2 << '\n';
-					// 	std::cout << "N-i=" << (N - i - 1) << '\n';
-					// 	std::cout << "----------\n";	
-					// }
-					
-					// if (vst2 + (N - i - 1) * 0.4 < vst1) {
-					// 	// std::cout << i << '\n';
-					// 	auto c1 = root->child[idx1], c2 = root->child[idx2];
-					// 	std::cout << vst1 << '\t' << vst2 << '\t' << i << '\n';
-					// 	std::cout << c1->win << '\t' << c2->win << '\n';
-					// 	std::cout << float(c1->win) / vst1 << '\t' << float(c2->win) / vst2 << '\n';
-					// 	std::cout << c1->rave_win << '\t' << c2->rave_win << '\n';
-					// 	std::cout << c1->rave_visit << '\t' << c2->rave_visit << '\n';
-					// 	std::cout << float(c1->rave_win) / c1->rave_visit << '\t' << float(c2->rave_win) / c2->rave_visit << '\n'; 
-					// }
-					if (vst2 + (N - i - 1) * 0.5 < vst1) return;
-					// if (i + 150 >= N - 1) std::cout << vst1 << '\t' << vst2 << '\t' << i << " safe\n";
-				}
+			}
+		}
+
+		/*
+			run n simulations, e.g., for the values of trainer
+		*/
+		void run_mcts(std::size_t n, std::default_random_engine& gen, pool& buf, float c, float k) {
+			for (auto i = 0u; i < n; ++i) {
+				board brd;
+				auto path{select_expend(buf, brd, c, k)};
+				rave_array ra = {};
+				update(buf, path, simulate(brd, gen, ra), ra);
 			}
 		}
 
 		/*
 			in opponent's thinking time, run this
 		*/
-		void run_mcts_after(bool& alive, action mv, std::default_random_engine& gen, std::vector<node>& buf, float c, float k) {
+		void run_mcts_after(const std::atomic<bool>& alive, action mv, std::default_random_engine& gen, pool& buf, float c, float k, std::size_t batch = 1) {
 			/*
 				find the child actioned by mv
 			*/
@@ -209,98 +462,208 @@ protected:
 			// 		break;
 			// 	}
 			// }
-			auto nd = root->child[root->get_index(mv)];
+			auto nd = find_child(buf, root, mv);
 
 			/*
 				main loop
 			*/
 			while (alive) {
-				auto path{select_expend(buf, c, k, nd)};
-				rave_array ra;
+				if (batch > 1) {
+					run_batch(batch, gen, buf, c, k, nd);
+					continue;
+				}
+				board brd;
+				auto path{select_expend(buf, brd, c, k, nd)};
+				rave_array ra = {};
 				// update(path, path.back()->simulate(gen, ra), ra);
-				update(path, simulate(*path.back(), gen, ra), ra);
-				// update(path, simulate_weight(*path.back(), gen, ra), ra);
+				update(buf, path, simulate(brd, gen, ra), ra);
 			}
 		}
 
 	public:
-		void initialze(const board& state, std::vector<node>& buf) {
-			buf.push_back(node(state));
-			root = &buf.back();
+		void initialze(const board& state, pool& buf) {
+			this->state = state;
+			buf.clear();
+			buf.init(root, -1);
+			rooted = true;
 		}
 
-		bool empty() const { return root == nullptr; }
-		void clear() { root = nullptr; }
+		bool empty() const { return !rooted; }
+		void clear() { rooted = false; }
 
-	protected:
+	public:
 		/*
-			move all node instances to buf
-			**ENSURE** buf has reserved enough space
-		*/
-		node* move(node* cur, std::vector<node>& buf) {
-			buf.push_back(std::move(*cur));
-			node* ncur = &buf.back();
-			for (auto i = 0u; i < ncur->child.size(); ++i) {
-				if (ncur->child[i] == nullptr) continue;
-				if (buf.capacity() == buf.size()) {
-					/*
-						forget child[i]
-					*/
-					// ncur->visit -= ncur->child[i]->visit;
-					// ncur->win -= (ncur->child[i]->visit - ncur->child[i]->win);
-					ncur->child[i] = nullptr;
-				}
-				else ncur->child[i] = move(ncur->child[i], buf);
+			promote the subtree of the state two moves later to the root in place, the rest is released
+			**ENSURE** no thread runs on the pool
+		*/
+		bool move(const board& state, pool& buf) {
+			board brd = this->state;
+			auto mv1 = brd.find_move(state);
+			if (board::bit_count(mv1) != 1 || brd.place(mv1) != board::legal) return false;
+			auto mv2 = brd.find_move(state);
+			if (board::bit_count(mv2) != 1 || brd.place(mv2) != board::legal || brd != state) return false;
+			auto ch = find_child(buf, root, board::bit_scan(mv1));
+			auto ch2 = ch != pool::none ? find_child(buf, ch, board::bit_scan(mv2)) : pool::none;
+			if (ch2 == pool::none) return false;
+			// auto s = size(buf, ch2);
+			// std::cout << "size1 = " << s << '\n';
+
+			this->state = brd;
+			index nd = buf.nodes[root];
+			buf.wins[root] = buf.wins[ch2], buf.visits[root] = buf.visits[ch2];
+			buf.rave_wins[root] = buf.rave_wins[ch2], buf.rave_visits[root] = buf.rave_visits[ch2];
+			buf.nodes[root] = buf.nodes[ch2], buf.nodes[ch2] = pool::none; // the link moves, so its count is kept
+			buf.release(nd);
+			return true;
+		}
+
+		/*
+			release the subtrees of the root children, only the child actioned by mv keeps its subtree
+			**ENSURE** no thread runs on the pool
+		*/
+		void move_after(action mv, pool& buf) {
+			auto idx = find_child(buf, root, mv);
+			index nd = buf.nodes[root];
+			if (nd == pool::none) return;
+			for (auto e = buf.firsts[nd]; e < buf.firsts[nd] + buf.counts[nd]; ++e) {
+				if (e == idx || buf.nodes[e] == pool::none) continue;
+				buf.release(buf.nodes[e]);
+				buf.nodes[e] = pool::none;
 			}
-			return ncur;
 		}
 
-	public:
-		bool move(const board& state, std::vector<node>& buf) {
-			for (auto i = 0u; i < root->child.size(); ++i) {
-				auto ch = root->child[i];
-				if (ch == nullptr) continue;
-				for (auto j = 0u; j < ch->child.size(); ++j) {
-					auto ch2 = ch->child[j];
-					if (ch2 == nullptr) continue;
-					if (static_cast<board>(*ch2) == state) {
-						// auto s = size(ch2);
-						// std::cout << "size1 = " << s << '\n';
-						
-						root = move(ch2, buf);
-						return true;
+		/*
+			release the subtrees below the edges visited fewer than least times, and return the nodes released
+			the statistics of the edges are kept, so that a subtree is only searched again from scratch
+			**ENSURE** no thread runs on the pool
+		*/
+		std::size_t evict(pool& buf, int least) const {
+			std::size_t live = buf.node_size();
+			std::vector<bool> seen(buf.node_cap);
+			std::vector<index> stack;
+			if (buf.nodes[root] != pool::none) stack.push_back(buf.nodes[root]);
+			while (stack.size()) {
+				index nd = stack.back();
+				stack.pop_back();
+				for (auto e = buf.firsts[nd]; e < buf.firsts[nd] + buf.counts[nd]; ++e) {
+					index ch = buf.nodes[e];
+					if (ch == pool::none) continue;
+					if (buf.visits[e] < least) {
+						buf.release(ch);
+						buf.nodes[e] = pool::none;
+					} else if (!seen[ch]) { // a node shared by the table is walked once
+						seen[ch] = true;
+						stack.push_back(ch);
 					}
 				}
 			}
-			return false;
-		}
-
-		void move_after(action mv, std::vector<node>& buf) {
-			auto idx = root->get_index(mv);
-			buf.push_back(*root);
-			root = &buf.back();
-			for (auto i = 0u; i < root->child.size(); ++i) {
-				if (root->child[i] == nullptr) continue;
-				if (i != idx) {
-					/*
-						forget child[i]
-					*/
-					// root->visit -= root->child[i]->visit;
-					// root->win -= (root->child[i]->visit - root->child[i]->win);
-					root->child[i] = nullptr;
-				} 
-				else root->child[i] = move(root->child[i], buf);
+			return live - buf.node_size();
+		}
+
+		/*
+			add the root statistics of another pool searched from the same state
+			**ENSURE** no thread runs on the pools
+		*/
+		void merge(const pool& other, pool& buf) const {
+			buf.wins[root] += other.wins[root], buf.visits[root] += other.visits[root];
+			buf.rave_wins[root] += other.rave_wins[root], buf.rave_visits[root] += other.rave_visits[root];
+			index from = other.nodes[root], to = buf.nodes[root];
+			if (from == pool::none) return;
+			if (to == pool::none && (to = buf.expend(root, state)) == pool::none) return;
+			buf.nexts[to] = std::max(buf.nexts[to], other.nexts[from]);
+			buf.totals[to] += other.totals[from];
+			for (index i = 0; i < buf.counts[to]; ++i) {
+				index a = buf.firsts[to] + i, b = other.firsts[from] + i;
+				buf.wins[a] += other.wins[b], buf.visits[a] += other.visits[b];
+				buf.rave_wins[a] += other.rave_wins[b], buf.rave_visits[a] += other.rave_visits[b];
+				if (other.proofs[b]) buf.proofs[a] = other.proofs[b];
 			}
 		}
 
-		// #ifdef DEMO
-		int size(node* nd) const {
-			int re = 0;
-			for (auto& ch : nd->child) if (ch != nullptr) re += size(ch);
-			return re + 1;
+		/*
+			sort the moves from root
+		*/
+		std::optional<action> find_best_order(const pool& buf, std::size_t ith, float k = 10.0) const {
+			index nd = buf.node(root);
+			if (nd == pool::none || nd == pool::busy || buf.counts[nd] <= ith) return std::nullopt;
+			index first = buf.firsts[nd];
+			std::vector<std::pair<int, int>> con;
+			/* a proven win is played at once, and a proven loss only if nothing else was visited */
+			auto order = [&](index e) { return buf.proof(e) > 0 ? std::numeric_limits<int>::min() : buf.proof(e) < 0 ? 1 : -buf.visit(e); };
+			for (auto i = 0; i < buf.counts[nd]; ++i) con.push_back({order(first + i), i});
+			// for (auto i = 0u; i < child.size(); ++i) con.push_back({child[i] == nullptr? 1 : float(child[i]->win) / child[i]->visit, i});
+			// for (auto i = 0u; i < child.size(); ++i) con.push_back({child[i] == nullptr? 0 : -child[i]->raved_visit(visit, k), i});
+			std::partial_sort(con.begin(), con.begin() + ith + 1, con.end());
+			// std::sort(con.begin(), con.end());
+			if (con[ith].first == 0) return std::nullopt;
+			// std::cout << "fbo " << ith << ' ' << con[ith].first << ' ' << con[ith].second << '\n';
+			return action::place(buf.moves[first + con[ith].second], state.info().who_take_turns);
 		}
-		int size() const {
-			return size(root);
+
+		/*
+			the edges of the most and the second most visited root children, none if there is not
+			it only reads the visits, so that it is cheap to call while the threads search
+		*/
+		std::pair<index, index> find_best_two(const pool& buf) const {
+			index nd = buf.node(root), best = pool::none, second = pool::none;
+			if (nd == pool::none || nd == pool::busy) return {best, second};
+			int vb = -1, vs = -1;
+			for (index ch = buf.firsts[nd]; ch < buf.firsts[nd] + buf.counts[nd]; ++ch) {
+				int v = buf.visit(ch);
+				if (v > vb) second = best, vs = vb, best = ch, vb = v;
+				else if (v > vs) second = ch, vs = v;
+			}
+			return {best, second};
+		}
+
+		/*
+			whether the win rate of the most visited root child is above the second most visited one with confidence,
+			i.e., its lower bound is above the upper bound of the second by z standard errors,
+			which take 1/n more for the small counts
+			the less visited children are not compared, the search already found them worse, and their bounds are loose
+		*/
+		bool confident(const pool& buf, float z) const {
+			auto [best, second] = find_best_two(buf);
+			if (best == pool::none || second == pool::none) return false;
+			auto bound = [&](index e, float sign) {
+				int n = std::max<int>(buf.visit(e), 1);
+				float p = 1 - float(buf.win(e)) / n;
+				return p + sign * z * std::sqrt((p * (1 - p) + 1.0f / n) / n);
+			};
+			return bound(best, -1) > bound(second, 1);
+		}
+
+		/*
+			1 if a root child is proven to win, -1 if all are proven to lose, so that the search is done, or 0
+		*/
+		int proven(const pool& buf) const {
+			index nd = buf.node(root);
+			if (nd == pool::none || nd == pool::busy) return 0;
+			bool lost = true;
+			for (index ch = buf.firsts[nd]; ch < buf.firsts[nd] + buf.counts[nd]; ++ch) {
+				if (buf.proof(ch) > 0) return 1;
+				lost = lost && buf.proof(ch) < 0;
+			}
+			return lost ? -1 : 0;
+		}
+
+		/*
+			return the visited edge of the move below the edge e, or none if there is not
+		*/
+		index find_child(const pool& buf, index e, int mv) const {
+			index nd = buf.node(e);
+			if (nd == pool::none || nd == pool::busy) return pool::none;
+			for (index ch = buf.firsts[nd]; ch < buf.firsts[nd] + buf.counts[nd]; ++ch)
+				if (buf.moves[ch] == mv && buf.visit(ch) != 0) return ch;
+			return pool::none;
+		}
+		index find_child(const pool& buf, index e, action mv) const {
+			return find_child(buf, e, action::place(mv).position().i);
+		}
+
+		// #ifdef DEMO
+		int size(const pool& buf) const {
+			return buf.node_size() - 1;
 		}
 		// #endif
 
@@ -313,273 +676,267 @@ protected:
 		// }
 
 	protected:
+		/*
+			select the edge of nd, whose visits are counted at the node in total, since the edges to nd may be many
+			log(total) is taken once for all edges, and the edges are scored 8 at once by avx2 if the cpu has it
+		*/
+		index select(const pool& buf, index nd, float c = 0.1, float k = 10.0) const {
+			index first = buf.firsts[nd], best = first, n = std::min(buf.next(nd).load(), buf.counts[nd]), i = 0;
+			float lp = log_visit(buf.total(nd));
+			float mx = -std::numeric_limits<float>::infinity();
+#ifdef MCTS_SELECT_AVX2
+			if (avx2_select && n >= 8) i = select_avx2(buf, first, n, lp, c, k, best, mx);
+#endif
+			for (index ch = first + i; ch < first + n; ++ch) {
+				float sc = score_log(buf, ch, lp, c, k);
+				if (mx < sc) mx = sc, best = ch;
+			}
+			return best;
+		}
+
+		float score(const pool& buf, index e, int par_visit, float c = 0.1, float k = 10.0) const {
+			return score_log(buf, e, log_visit(par_visit), c, k);
+		}
+
+		/*
+			the score of the edge e, lp is the log of the visits of its parent
+		*/
+		float score_log(const pool& buf, index e, float lp, float c = 0.1, float k = 10.0) const {
+			/* a proven win is taken at once, and a proven loss never unless all are */
+			if (int proof = buf.proof(e)) return proof * std::numeric_limits<float>::infinity();
+			int win = buf.win(e), visit = buf.visit(e);
+			int rave_win = buf.rave_win(e), rave_visit = buf.rave_visit(e);
+			/* claimed by another thread, but not counted yet */
+			if (visit == 0 || rave_visit == 0) return std::numeric_limits<float>::infinity();
+			float exploit = float(win) / visit;
+			float rave_exploit = float(rave_win) / rave_visit;
+			float beta = std::sqrt(k / (3 * visit + k));
+			float explore = std::sqrt(lp) * inv_sqrt_visit(visit);
+			// return -exploit + c * explore; 
+			return (beta - 1) * exploit - beta * rave_exploit + c * explore;
+		}
+
+		/*
+			the small visit counts are looked up, the deep trees mostly select among them
+		*/
+		static constexpr int tabled = 4096;
+		static inline const std::array<float, tabled> log_table = [] {
+			std::array<float, tabled> t = {0};
+			for (int i = 1; i < tabled; ++i) t[i] = std::log(float(i));
+			return t;
+		}();
+		static inline const std::array<float, tabled> inv_sqrt_table = [] {
+			std::array<float, tabled> t = {0};
+			for (int i = 1; i < tabled; ++i) t[i] = 1 / std::sqrt(float(i));
+			return t;
+		}();
+		static float log_visit(int v) { return v < tabled ? log_table[std::max(v, 0)] : std::log(float(v)); }
+		static float inv_sqrt_visit(int v) { return v < tabled ? inv_sqrt_table[v] : 1 / std::sqrt(float(v)); }
+
+#ifdef MCTS_SELECT_AVX2
+		/*
+			score the edges [first, first + n) 8 at once, and return how many are scored
+			best and mx are the first edge of the max score and its score, as select() keeps them
+		*/
+		MCTS_SELECT_TARGET static index select_avx2(const pool& buf, index first, index n, float lp, float c, float k, index& best, float& mx) {
+			const __m256 kk = _mm256_set1_ps(k), cc = _mm256_set1_ps(c), one = _mm256_set1_ps(1), three = _mm256_set1_ps(3);
+			const __m256 sq = _mm256_set1_ps(std::sqrt(lp)), inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+			__m256 mxs = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+			__m256i at = _mm256_setzero_si256(), lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			index i = 0;
+			for (; i + 8 <= n; i += 8, lane = _mm256_add_epi32(lane, _mm256_set1_epi32(8))) {
+				__m256i vi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf.visits.get() + first + i));
+				__m256i rvi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf.rave_visits.get() + first + i));
+				__m256 w = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf.wins.get() + first + i)));
+				__m256 rw = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf.rave_wins.get() + first + i)));
+				__m256 v = _mm256_cvtepi32_ps(vi), rv = _mm256_cvtepi32_ps(rvi);
+				__m256 exploit = _mm256_div_ps(w, v), rave_exploit = _mm256_div_ps(rw, rv);
+				__m256 beta = _mm256_sqrt_ps(_mm256_div_ps(kk, _mm256_add_ps(_mm256_mul_ps(three, v), kk)));
+				__m256 explore = _mm256_div_ps(sq, _mm256_sqrt_ps(v));
+				__m256 sc = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(beta, one), exploit), _mm256_mul_ps(beta, rave_exploit));
+				sc = _mm256_add_ps(sc, _mm256_mul_ps(cc, explore));
+				/* claimed by another thread, but not counted yet */
+				__m256i fresh = _mm256_or_si256(_mm256_cmpeq_epi32(vi, _mm256_setzero_si256()), _mm256_cmpeq_epi32(rvi, _mm256_setzero_si256()));
+				sc = _mm256_blendv_ps(sc, inf, _mm256_castsi256_ps(fresh));
+				/* the proven edges, as score_log() */
+				__m256i proof = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(buf.proofs.get() + first + i)));
+				sc = _mm256_blendv_ps(sc, inf, _mm256_castsi256_ps(_mm256_cmpgt_epi32(proof, _mm256_setzero_si256())));
+				sc = _mm256_blendv_ps(sc, _mm256_sub_ps(_mm256_setzero_ps(), inf), _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_setzero_si256(), proof)));
+				__m256 gt = _mm256_cmp_ps(sc, mxs, _CMP_GT_OQ);
+				mxs = _mm256_blendv_ps(mxs, sc, gt);
+				at = _mm256_blendv_epi8(at, lane, _mm256_castps_si256(gt));
+			}
+			alignas(32) float scs[8];
+			alignas(32) int ats[8];
+			_mm256_store_ps(scs, mxs);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(ats), at);
+			for (int j = 0; j < 8; ++j)
+				if (mx < scs[j] || (mx == scs[j] && first + ats[j] < best)) mx = scs[j], best = first + ats[j];
+			return i;
+		}
+#endif
+
+		/*
+			whether nd should claim its next edge, best is set if a claimed edge was selected to decide it
+		*/
+		bool widen(const pool& buf, index nd, index& best, float c, float k) const {
+			int claimed = buf.next(nd);
+			if (claimed >= buf.counts[nd]) return false;
+			if (claimed == 0 || widening_mode == widening::all) return true;
+			if (widening_mode == widening::pw) return claimed < pw_c * std::pow(float(buf.total(nd)), pw_alpha);
+			/* the score of a claimed edge is its win rate minus 1 plus the exploration */
+			best = select(buf, nd, c, k);
+			return score(buf, best, buf.total(nd), c, k) < fpu - 1;
+		}
+
 		/*
 			assigned_child is a child of root
 			means we only search the subtree rooted from it
+			return the edges on the path, and brd is set to the board of the leaf
 		*/
-		std::vector<node*> select_expend(std::vector<node>& buf, float c = 0.05, float k = 10.0, node* assigned_child = nullptr) {
-			std::vector<node*> path = {root};
-			++root->visit, ++root->rave_visit;
-			if (assigned_child != nullptr) {
-				path.push_back(assigned_child);
-				++assigned_child->visit, ++assigned_child->rave_visit;
-			}
-			while (path.back()->proceedable() && path.back()->fully_visited()) {
-				auto nd = path.back()->select(c, k);
-				path.push_back(nd);
+		std::vector<index> select_expend(pool& buf, board& brd, float c = 0.05, float k = 10.0, index assigned_child = pool::none) {
+			std::vector<index> path = {root};
+			brd = state;
+			buf.visit(root) += 1 + vloss, buf.win(root) += vloss, ++buf.rave_visit(root);
+			auto enter = [&](index e) {
+				path.push_back(e);
+				brd.place(int(buf.moves[e]));
 				/*
 					virtual loss
+					the visit is counted before the win, and vloss more visits lost by the mover of e are kept until update(),
+					so that the other threads find e worse while its simulation is pending
+				*/
+				buf.visit(e) += 1 + vloss;
+				buf.win(e) += vloss;
+				++buf.rave_visit(e);
+			};
+			if (assigned_child != pool::none) enter(assigned_child);
+			while (brd.available()) {
+				index nd = buf.node(path.back());
+				if (nd == pool::none) nd = buf.expend(path.back(), brd);
+				if (nd == pool::none || nd == pool::busy) break; // the pool is full, or another thread is expending it
+				++buf.total(nd);
+				/*
+					expend the next child in order, or select one of the claimed children
 				*/
-				++nd->visit;
-				++nd->rave_visit;
+				index best = pool::none;
+				if (widen(buf, nd, best, c, k)) {
+					auto i = buf.next(nd)++;
+					if (i < buf.counts[nd]) {
+						enter(buf.firsts[nd] + i);
+						break;
+					}
+				}
+				enter(best != pool::none ? best : select(buf, nd, c, k));
 			}
-			if (auto res = path.back()->expend(buf)) path.push_back(*res), ++(*res)->visit, ++(*res)->rave_visit;;
 			// else path.back() is a terminal node
+			/* the side to move has no move and loses, so the last move is proven to win */
+			if (!brd.available() && path.size() > 1) buf.proof(path.back()) = 1;
 
 			return path;
 		}
 
-		void update(std::vector<node*>& path, board::piece_type win, rave_array& ra) {
-			auto who = root->info().who_take_turns;
-			for (auto& nd : path) {
+		void update(pool& buf, std::vector<index>& path, board::piece_type win, rave_array& ra) {
+			auto who = state.info().who_take_turns;
+			for (auto d = 0u; d < path.size(); ++d) {
+				auto e = path[d];
+				/*
+					revert the virtual loss
+				*/
+				if (vloss) buf.win(e) -= vloss, buf.visit(e) -= vloss;
+
 				/*
-					mornal update
+					mornal update, who takes turns at the edges of even depth
 				*/
-				auto ndwho = nd->info().who_take_turns;
-				if (win == who && ndwho == who)      ++nd->win, ++nd->rave_win;
-				else if (win != who && ndwho != who) ++nd->win, ++nd->rave_win;
+				bool ewho = d % 2 == 0;
+				if ((win == who) == ewho) ++buf.win(e), ++buf.rave_win(e);
 
 				/*
 					rave update
 				*/
-				for (auto& ch : nd->child) {
-					if (ch == nullptr) continue;
-					auto chwho = ch->info().who_take_turns;
-					if (ra[chwho - 1][nd->find_move_index(*ch)]) {
-						++ch->rave_visit;
-						if (win == who && chwho == who)      ++ch->rave_win;
-						else if (win != who && chwho != who) ++ch->rave_win;
+				index nd = buf.node(e);
+				if (nd == pool::none || nd == pool::busy) continue;
+				auto chwho = ewho ? board::opponent(who) : who;
+				for (index ch = buf.firsts[nd]; ch < buf.firsts[nd] + std::min(buf.next(nd).load(), buf.counts[nd]); ++ch) {
+					if (ra[chwho - 1] & board::shifted(buf.moves[ch])) {
+						++buf.rave_visit(ch);
+						if ((win == who) != ewho) ++buf.rave_win(ch);
 					}
-				} 
+				}
+			}
+
+			/*
+				back up the proofs by minimax, the move is lost if a reply wins,
+				and won if all replies are claimed and lost
+			*/
+			for (auto d = path.size() - 1; d > 1 && buf.proof(path[d]); --d) {
+				index e = path[d - 1], nd = buf.node(e);
+				if (buf.proof(path[d]) > 0) {
+					buf.proof(e) = -1;
+					continue;
+				}
+				if (nd == pool::none || nd == pool::busy || buf.next(nd) < buf.counts[nd]) break;
+				index ch = buf.firsts[nd];
+				while (ch < buf.firsts[nd] + buf.counts[nd] && buf.proof(ch) < 0) ++ch;
+				if (ch < buf.firsts[nd] + buf.counts[nd]) break;
+				buf.proof(e) = 1;
 			}
 		}
 
-		board::piece_type simulate(const board& state, std::default_random_engine& gen, rave_array& ra) const {
-			board brd = state;
-			while (auto mv = brd.random_action(gen)) {
-				ra[brd.info().who_take_turns - 1][*mv] = true;
-				brd.place(*mv);
+		/*
+			select batch leaves and simulate them at once by the batched playouts
+			every path keeps its virtual loss until updated, so that the leaves spread over the tree,
+			at least batch_vloss of it even if vloss is off, otherwise the lanes crowd into the same subtree
+		*/
+		void run_batch(std::size_t batch, std::default_random_engine& gen, pool& buf, float c, float k, index assigned_child = pool::none) {
+			std::vector<index> paths[playout::max_lanes];
+			board brds[playout::max_lanes];
+			const board* leaves[playout::max_lanes] = {};
+			playout::result res[playout::max_lanes] = {};
+			int extra = std::max(batch_vloss - vloss, 0);
+			for (auto j = 0u; j < batch; ++j) {
+				paths[j] = select_expend(buf, brds[j], c, k, assigned_child);
+				for (auto e : paths[j]) buf.visit(e) += extra, buf.win(e) += extra;
+				leaves[j] = &brds[j];
+			}
+			playout::run(leaves, batch, gen, res);
+			for (auto j = 0u; j < batch; ++j) {
+				for (auto e : paths[j]) buf.win(e) -= extra, buf.visit(e) -= extra;
+				rave_array ra = {res[j].moves[1], res[j].moves[2]};
+				update(buf, paths[j], res[j].winner, ra);
+			}
+		}
+		static constexpr int batch_vloss = 3; // the least virtual loss of the lanes of a batch
+
+		board::piece_type simulate(board brd, std::default_random_engine& gen, rave_array& ra) const {
+			board::bitboard rest[3];
+			/* the moves are drawn by their patterns if the weights are loaded, see heavy_playout */
+			std::optional<heavy_playout::walk> policy;
+			if (heavy) policy.emplace(*heavy, brd);
+			while (true) {
+				/* stop once the rest of the moves are independent */
+				if (auto win = settle ? brd.settle(gen, rest) : board::empty) {
+					ra[0] |= rest[1], ra[1] |= rest[2];
+					return win;
+				}
+				auto mv = policy ? policy->action(gen) : brd.random_action(gen);
+				if (!mv) break;
+				ra[brd.info().who_take_turns - 1] |= board::shifted(*mv);
+				if (policy) policy->place(*mv);
+				else brd.place(*mv);
 			}
 			return brd.info().who_take_turns == board::white? board::black : board::white;
 		}
 
-	/*
-		this part is about weighted simulation
-	*/
-	// public:
-	// 	void load_weight(const std::string& fname) {
-	// 		// std::cout << "load weight\n";
-	// 		std::ifstream fin(fname);
-	// 		if (!fin) throw std::invalid_argument("file not exists");
-	// 		uint64_t size = 0;
-	// 		fin.read(reinterpret_cast<char*>(&size), sizeof(uint64_t));
-	// 		weight.resize(size);
-	// 		fin.read(reinterpret_cast<char*>(weight.data()), sizeof(float) * size);
-	// 		// return out;
-	// 		// float tmp;
-	// 		// while (fin >> tmp) weight.push_back(tmp);
-	// 		fin.close();
-	// 	}
-
-	// 	void save_weight(const std::string& fname) {
-	// 		// std::cout << "save weight\n";
-	// 		std::ofstream fout(fname);
-	// 		if (!fout) throw std::invalid_argument("file not exists");
-	// 		uint64_t size = weight.size();
-	// 		fout.write(reinterpret_cast<const char*>(&size), sizeof(uint64_t));
-	// 		fout.write(reinterpret_cast<const char*>(weight.data()), sizeof(float) * size);
-	// 		// fout << std::fixed << std::setprecision(6);
-	// 		// for (auto& v : weight) fout << v << '\n';
-	// 		fout.close();
-	// 	}
-
-	// 	void run_mcts_balancing(std::size_t N, std::size_t move_count, std::default_random_engine& gen, std::vector<node>& buf, float c, float k, float alpha) {
-	// 		for (auto i = 0u; i < N; ++i) {
-	// 			auto path{select_expend(buf, c, k)};
-	// 			rave_array ra;
-	// 			// std::cout << i << '\t';
-	// 			// std::cout << path.size() << ' ';
-	// 			simulation_balancing(10 * move_count, *path.back(), gen, c, k, alpha);
-	// 			update(path, simulate_weight(*path.back(), gen, ra), ra);
-	// 		}
-	// 	}
-
-	// 	std::optional<int> weight_action(const board& state, std::default_random_engine& gen) const {
-	// 		auto av = state.available(state.info().who_take_turns);
-	// 		if (!av) return std::nullopt;
-	// 		std::vector<std::pair<float, int>> mvs;
-	// 		double sm = 0;
-	// 		for (auto i = 0u; av; ++i, av = reset(av)) {
-	// 			int mv = board::bit_scan(lsb(av));
-	// 			mvs.push_back({std::exp(score(get_weight(state, mv))), mv});
-	// 			sm += mvs.back().first;
-	// 		}
-	// 		auto ch = std::uniform_real_distribution<float>(0, sm)(gen);
-	// 		for (auto i = 0u; i < mvs.size(); ++i) {
-	// 			if (ch < mvs[i].first) return mvs[i].second;
-	// 			ch -= mvs[i].first;
-	// 		}
-	// 		return std::nullopt;
-	// 	}
-
-	// 	board::piece_type simulate_weight(const board& state, std::default_random_engine& gen, rave_array& ra) const {
-	// 		board brd = state;
-	// 		while (auto mv = weight_action(brd, gen)) {
-	// 			ra[brd.info().who_take_turns - 1][*mv] = true;
-	// 			brd.place(*mv);
-	// 		}
-	// 		return brd.info().who_take_turns == board::white? board::black : board::white;
-	// 	}
-
-	// 	/*
-	// 		training the weight
-	// 		1. run mcts on the state M times, calc the win rate V*, assuming the god solution
-	// 		2. run simulation_weight M times, calc the win rate V
-	// 		3. run simulation_weight N times, sum the whole weight, and average, called g
-	// 		4. train the weight by alpha * (V* - V) * g
-
-	// 		that is, if V is overestimated, then decrease g
-	// 		otherwise, if V is underestimated, then increase g
-	// 	*/
-	// 	void simulation_balancing(std::size_t N, const board& state, std::default_random_engine& gen, float c, float k, float alpha = 0.1) {
-	// 		// std::size_t N = 500;
-	// 		/*
-	// 			step 1. calc the V*
-	// 		*/
-	// 		// std::cout << "calc V*\n";
-	// 		if (!state.available()) return;
-	// 		// std::cout << "turn " << int(state.info().who_take_turns) << ' ';
-	// 		tree tre;
-	// 		std::vector<node> buf;
-	// 		buf.reserve(N + 100);
-	// 		tre.initialze(state, buf);
-	// 		tre.run_mcts(N, gen, buf, c, k);
-	// 		float v_star = float(tre.root->win) / tre.root->visit;
-
-	// 		/*
-	// 			step 2 and 3. calc the V and get the current weight vector
-	// 		*/
-	// 		// std::cout << "calc V and g\n";
-	// 		float v = 0;
-	// 		// std::size_t move_count = 0;
-	// 		std::vector<float> cur_weight(weight.size()), opp_weight(weight.size());
-	// 		for (auto i = 0u; i < N; ++i) {
-	// 			board brd = state;
-	// 			while (auto mv = weight_action(brd, gen)) {
-	// 				auto same = brd.info().who_take_turns == state.info().who_take_turns;
-	// 				if (same) for (auto& [code, v] : get_weight(brd, *mv)) cur_weight[code] += v;
-	// 				else      for (auto& [code, v] : get_weight(brd, *mv)) opp_weight[code] += v;
-	// 				// cur_weight[encode(state, *mv)] += 1;
-	// 				// ++move_count;
-	// 				brd.place(*mv);
-	// 			}
-	// 			if (brd.info().who_take_turns != state.info().who_take_turns) v += 1;
-	// 		}
-	// 		v /= N;
-	// 		auto norm = [](const std::vector<float>& vec) {
-	// 			float re = 0;
-	// 			for (auto v : vec) re += v * v;
-	// 			return re;
-	// 		};
-	// 		auto normalize = [](std::vector<float>& vec) {
-	// 			float acc = std::accumulate(vec.begin(), vec.end(), 0.0);
-	// 			// std::cout << acc;
-	// 			for (auto& v : vec) v /= acc;
-	// 			// std::cout << " " << std::accumulate(vec.begin(), vec.end(), 0.0) << '\n';
-	// 		};
-
-	// 		normalize(cur_weight);
-	// 		/*
-	// 			opponent at least one move
-	// 		*/
-	// 		if (norm(opp_weight) > 1e-5) {
-	// 			float nwei = norm(weight);
-	// 			normalize(opp_weight);	
-	// 			for (auto i = 0u; i < weight.size(); ++i) cur_weight[i] += (weight[i] / nwei - opp_weight[i]);
-	// 			for (auto& v : cur_weight) v /= 2.f;
-	// 		}
-
-	// 		/*
-	// 			step 4. train
-	// 		*/
-	// 		// std::cout << "train\n";
-	// 		float sm = 0, mx = 0, v3 = 0;
-	// 		for (auto i = 0u; i < weight.size(); ++i) {
-	// 			v3 += weight[i] * cur_weight[i];
-	// 			weight[i] += alpha * (v_star - v) * cur_weight[i];
-	// 			sm += std::abs(alpha * (v_star - v) * cur_weight[i]);
-	// 			mx = std::max(mx, std::abs(alpha * (v_star - v) * cur_weight[i]));
-	// 		}
-	// 		// std::cout << "train=" << sm << "    \t" << "mx=" << mx << "     \t";
-	// 		std::cout << std::fixed << std::setprecision(5) << "V*=" << v_star << " V=" << v << " V3= " << v3 <<'\n';
-	// 	}
-
-	// protected:
-	// 	std::vector<std::pair<std::size_t, float>> get_weight(const board& state, int mv) const {
-	// 		auto get_weight_single = [&](const board& state, int mv) {
-	// 			std::vector<std::pair<std::size_t, float>> re;
-	// 			int x = mv / 9, y = mv % 9;
-	// 			for (auto i = -1; i <= 1; ++i) {
-	// 				for (auto j = -1; j <= 1; ++j) {
-	// 					// if (i == j && i == 0) continue;
-	// 					int nx = x + i, ny = y + j, idx = nx * 9 + ny;
-	// 					if (nx < 0 || ny < 0 || nx >= 9 || ny >= 9) continue;
-	// 					auto p = state(nx, ny);
-	// 					if (p == state.info().who_take_turns) re.push_back({encode(state, idx), 1});
-	// 					else if (p == 3 - state.info().who_take_turns) re.push_back({encode(state, idx), -1});
-	// 				}
-	// 			}
-	// 			return re;
-	// 		};
-
-	// 		auto org = get_weight_single(state, mv);
-	// 		board brd = state;
-	// 		brd.place(mv);
-	// 		auto cur = get_weight_single(brd, mv);
-	// 		std::vector<std::pair<std::size_t, float>> re;
-	// 		for (auto& [code, v] : org) re.push_back({code, -v});
-	// 		for (auto& [code, v] : cur) re.push_back({code, -v});
-	// 		return re;
-	// 	}
-
-	// 	float score(const std::vector<std::pair<std::size_t, float>>& wei) const {
-	// 		float re = 0;
-	// 		for (auto& [code, v] : wei) re += v * weight[code];
-	// 		return re;
-	// 	}
-
-	// 	std::size_t encode(const board& state, int mv) const {
-	// 		std::size_t re = 0;
-	// 		int x = mv / 9, y = mv % 9;
-	// 		for (auto i = -1; i <= 1; ++i) {
-	// 			for (auto j = -1; j <= 1; ++j) {
-	// 				if (i == j && i == 0) continue;
-	// 				int nx = x + i, ny = y + j;
-	// 				if (nx < 0 || ny < 0 || nx >= 9 || ny >= 9) continue;
-	// 				auto p = state(nx, ny);
-	// 				re <<= 2;
-	// 				if (p == board::piece_type::hollow) continue;
-	// 				if (p == board::piece_type::empty) re += 3;
-	// 				else if (p == state.info().who_take_turns) re += 1;
-	// 				else re += 2;
-	// 			}
-	// 		}
-	// 		return re;
-	// 	}
-
 	public:
-		node* root = nullptr;
-		// std::vector<float> weight;
+		board state; // the board at root
+		bool rooted = false;
+		bool settle = false; // finish a simulation once its moves are independent, see board::settle()
+		int vloss = 0; // extra lost visits added on the way down and removed on the way up, spreads threads over the tree
+		widening widening_mode = widening::all; // widen=all|fpu|pw
+		float fpu = 1.0; // the urgency of an unclaimed edge, as a win rate
+		float pw_c = 1.0, pw_alpha = 0.5; // a node widens to pw_c * total^pw_alpha claimed edges
+		std::shared_ptr<const heavy_playout> heavy; // the policy of the heavy playouts, or null for uniform random playouts
 	};
 
 protected:
@@ -591,30 +948,164 @@ protected:
 	}
 
 	void end_after_mcts() {
-		is_thread_alive = false;
-		for (auto& thrs : afters) thrs.join();
-		afters.clear();
+		searchers.stop();
 	}
 
 	void reallocate(const board& state) {
 		// std::cout << "reallocation\n";
-		std::vector<node> buf_tmp;
-		buf_tmp.reserve(reserve_main);
-		if (tre.empty()) tre.initialze(state, buf_tmp);
-		else if (!tre.move(state, buf_tmp)) tre.initialze(state, buf_tmp);
-		buf_main = std::move(buf_tmp);
+		if (tre.empty() || root_parallel || !tre.move(state, buf_main)) tre.initialze(state, buf_main);
 		for (auto& buf : bufs) buf.clear();
 		// std::cout << "size = " << tre.size() << '\n';
 	}
 
 	void reallocate_after(action mv) {
-		std::vector<node> buf_tmp;
-		buf_tmp.reserve(reserve_main);
-		tre.move_after(mv, buf_tmp);
-		buf_main = std::move(buf_tmp);
+		tre.move_after(mv, buf_main);
 		for (auto& buf : bufs) buf.clear();
 	}
 
+	/*
+		search until the time of this move is used, the searchers stop together once halted
+		the move is given budget ms, and up to limit ms while the root is unstable,
+		i.e., the best child changed lately or the second is close to it
+		the search stops early once the best is settled, see settled(), or the move is forced,
+		and the time saved is returned to be banked
+	*/
+	double think(std::chrono::steady_clock::time_point begin, double budget, double limit) {
+		auto elapsed = [&] { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count(); };
+		auto sims = [&] {
+			if (!root_parallel) return buf_main.visit(tree::root).load();
+			int n = 0;
+			for (auto& buf : bufs) n += buf.visit(tree::root);
+			return n;
+		};
+
+		/*
+			hand the searchers over to mcts, which are halted to reclaim the pools once they are full
+			in root parallel, every thread searches its own tree in its own buffer
+		*/
+		auto launch = [&] {
+			searchers.start([this](std::size_t i, const std::atomic<bool>& alive) {
+				tre.run_mcts(alive, gens[i], root_parallel ? bufs[i] : buf_main, c, k, batch);
+			});
+		};
+		auto halt = [&] { searchers.stop(); };
+		std::vector<pool*> pools;
+		if (root_parallel) for (auto& buf : bufs) tre.initialze(tre.state, buf), pools.push_back(&buf);
+		else pools.push_back(&buf_main);
+		for (auto buf : pools) reclaim(*buf); // filled in the opponent's time
+		launch();
+
+		/*
+			the threads of root parallel are sampled by the first one
+		*/
+		const pool& probe = root_parallel ? bufs[0] : buf_main;
+		auto tick = std::chrono::microseconds(std::clamp<long>(budget * 10, 1000, 10000));
+		double start = elapsed(), changed = start;
+		int sims0 = sims();
+		tree::index last = pool::none;
+		double saved = 0;
+		while (tre.state.available()) {
+			std::this_thread::sleep_for(tick);
+			double now = elapsed();
+			if (now >= limit) break;
+
+			/* a proven root is not searched further */
+			if (std::any_of(pools.begin(), pools.end(), [&](pool* buf) { return tre.proven(*buf) != 0; })) {
+				saved = std::max(budget - now, 0.0);
+				break;
+			}
+
+			if (memory && std::any_of(pools.begin(), pools.end(), [](pool* buf) { return buf->full(); })) {
+				halt();
+				for (auto buf : pools) reclaim(*buf);
+				launch();
+			}
+
+			auto [best, second] = tre.find_best_two(probe);
+			if (best == pool::none) continue; // the root is not expanded yet
+			/* a forced move needs no search */
+			if (second == pool::none) {
+				saved = std::max(budget - now, 0.0);
+				break;
+			}
+			if (best != last) last = best, changed = now;
+			int v1 = probe.visit(best), v2 = probe.visit(second);
+			double rate = (sims() - sims0) / std::max(now - start, 1.0) / (root_parallel ? thread_size : 1);
+
+			double rest = (now < budget ? budget : limit) - now;
+			if (8 * now > budget && settled(probe, v1, v2, rest * rate)) {
+				saved = std::max(budget - now, 0.0);
+				break;
+			}
+			if (now < budget) continue;
+			bool unstable = now - changed < budget * 0.25 || 5 * v2 > 4 * v1;
+			if (!unstable) break;
+		}
+		halt();
+		for (auto buf : pools) reclaim(*buf); // leave room for the opponent's time
+		if (root_parallel) for (auto& buf : bufs) tre.merge(buf, buf_main);
+
+		if (stat) {
+			double now = elapsed();
+			stat_out << "Sims    : " << sims() - sims0 << ' ' << (sims() - sims0) / std::max(now - start, 1.0) << "/ms" << std::endl;
+			stat_out << "Elapsed : " << now << " ms" << std::endl;
+			stat_out << "Memory  : " << evictions << " evictions, " << evicted << " nodes evicted, " << exhaustions << " allocations failed" << std::endl;
+		}
+		return saved;
+	}
+
+	/*
+		whether the best root child cannot be overtaken, rest is the simulations left of the move
+		visits: EARLY-C, the second cannot catch up by early_c of the rest
+		bound: the win rate of the best is above the others by early_z standard errors, see tree::confident()
+	*/
+	bool settled(const pool& probe, int v1, int v2, double rest) const {
+		switch (early_stop) {
+		case early::visits: return v2 + rest * early_c < v1;
+		case early::bound: return tre.confident(probe, early_z);
+		default: return false;
+		}
+	}
+
+	/*
+		count the failed allocations of buf, and if any under the memory budget,
+		evict the least visited subtrees until a quarter of its nodes are released
+		**ENSURE** no thread runs on the pool
+	*/
+	void reclaim(pool& buf) {
+		auto missed = buf.exhausted();
+		if (!missed) return;
+		exhaustions += missed;
+		if (!memory) return;
+		auto target = buf.node_size() - buf.node_size() / 4;
+		for (int least = 2; buf.node_size() > target && least <= buf.visits[tree::root]; least *= 2) evicted += tre.evict(buf, least);
+		++evictions;
+	}
+
+	/*
+		the budget and the limit of this move in ms, see think()
+		the clock reported by time_left() is trusted if any, otherwise time is counted down by the time spent
+		the budget is a share of the main time, or of the byo-yomi stones, and a move may always spend its byo-yomi share
+		the time saved by the early stops is banked, and bank of the banked time is added to the budget
+		the limit keeps time_margin ms of the clock in any case
+	*/
+	std::pair<double, double> allot() const {
+		double period = byo_stones > 0 ? byo_time * 1000 / byo_stones : 0;
+		double rem, budget;
+		if (clock_left >= 0 && clock_stones > 0) { // in byo-yomi, the time left is for clock_stones moves
+			rem = clock_left * 1000;
+			budget = rem / clock_stones;
+		} else {
+			double main_rem = clock_left >= 0 ? clock_left * 1000 : std::max(time * 1000.0 - time_elp, 0.0);
+			// std::cout << "time remaining = " << main_rem / 1000 << '\n';
+			budget = std::max(main_rem / (c_time + max_ply_mul * std::max(max_ply - move_count, 0)), period);
+			rem = main_rem + period;
+		}
+		budget += banked * bank;
+		double limit = std::min(budget * time_extend, std::max(rem - time_margin, 0.0));
+		return {std::min(budget, limit), limit};
+	}
+
 	void update_time(std::chrono::steady_clock::time_point& begin) {
 		auto end = std::chrono::steady_clock::now();
 		time_elp += std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
@@ -635,28 +1126,6 @@ public:
 		begin = std::chrono::steady_clock::now();
 		++move_count;
 
-		/*
-			simulation balancing
-		*/
-		// if (meta.find("balancing") != meta.end()) {
-		// 	std::cout << "balancing action\n";
-		// 	float alpha = 0.1;
-		// 	assign("alpha", alpha);
-		// 	buf_main.clear();
-		// 	tre.initialze(state, buf_main);
-		// 	tre.run_mcts_balancing(500, move_count, gens[0], buf_main, c, k, alpha);
-		// 	/*
-		// 		maintain time elp
-		// 	*/
-		// 	auto end = std::chrono::steady_clock::now();
-		// 	time_elp += std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
-
-		// 	if (meta.find("save") != meta.end()) tre.save_weight(meta["save"]);
-
-		// 	if (auto mv = tre.root->find_best_order(0)) return *mv;
-		// 	return action();
-		// }
-
 		/*
 			terminate after mcts
 		*/
@@ -679,26 +1148,20 @@ public:
 		
 
 		/*
-			calculating remaining time (Enhanced) and # of mcts can do
+			calculating remaining time (Enhanced) and the time of this move
 		*/
-		std::size_t time_rem = time * 1000 - time_elp;
-		// std::cout << "time remaining = " << time_rem / 1000 << '\n';
-		std::size_t T = time_rem / (c_time + max_ply_mul * std::max(max_ply - move_count, 0)) * mcts_per_ms;
-		// std::cout << "T = " << T << '\n';
-		// T=100;
+		auto [budget, limit] = allot();
 		if (stat) {
-			stat_out << "T       : " << T << std::endl;
-			stat_out << "Time    : " << time_rem / 1000 << std::endl;
+			stat_out << "Budget  : " << budget << ' ' << limit << " ms" << std::endl;
+			stat_out << "Time    : " << (clock_left >= 0 ? clock_left : std::max(time - time_elp / 1000.0, 0.0)) << std::endl;
 		}
 
-		/*
-			generate threads for mcts
-		*/
-		std::vector<std::thread> thrs;
-		for (auto i = 0u; i < thread_size; ++i) {
-			thrs.push_back(std::thread(&tree::run_mcts, tre, T, std::ref(gens[i]), std::ref(bufs[i]), c, k));
-		}
-		for (auto& thr : thrs) thr.join();
+		banked *= 1 - bank;
+		double saved = think(begin, budget, limit);
+		banked += saved;
+		if (stat) stat_out << "Early   : " << saved << " ms saved, " << banked << " ms banked" << std::endl;
+		if (stat) stat_out << "Nodes   : " << buf_main.node_size() - 1 << ' ' << buf_main.size() << std::endl;
+		if (stat && tre.proven(buf_main)) stat_out << "Proven  : " << (tre.proven(buf_main) > 0 ? "win" : "loss") << std::endl;
 
 		// if (stat) {
 		// 	// stat_out << "main: " << buf_main.size() << '\n';
@@ -714,15 +1177,22 @@ public:
 		// }
 		
 
-		if (auto re = tre.root->find_best_order(0, k)) {
+		/*
+			the time ran out before any simulation, play a random move rather than resign
+		*/
+		auto re = tre.find_best_order(buf_main, 0, k);
+		if (!re) {
+			if (auto mv = board(state).random_action(gens[0])) re = action::place(*mv, state.info().who_take_turns);
+		}
+		if (re) {
 			if (meta.find("skip") != meta.end()) {
 				update_time(begin);
 				return *re;
 			}
 
 			if (stat) {
-				auto nd = tre.root->child[tre.root->get_index(*re)];
-				stat_out << "win rate: " << 1.0 - float(nd->win) / nd->visit << std::endl;
+				auto nd = tre.find_child(buf_main, tree::root, *re);
+				stat_out << "win rate: " << 1.0 - float(buf_main.wins[nd]) / buf_main.visits[nd] << std::endl;
 			}
 
 			// if (stat) {
@@ -732,18 +1202,25 @@ public:
 			// 	stat_out << v1 << ' ' << v2 << std::endl;
 			// }
 			
+			/*
+				the merged root has no subtree to search in the opponent's time
+			*/
+			if (root_parallel) {
+				update_time(begin);
+				return *re;
+			}
+
 			/*
 				reuse preallocation for after
 			*/
 			reallocate_after(*re);
 
 			/*
-				generate threads for after mcts
+				hand the searchers over to after mcts, until the next take_action()
 			*/
-			is_thread_alive = true;
-			for (auto i = 0u; i < thread_size; ++i) {
-				afters.push_back(std::thread(&tree::run_mcts_after, tre, std::ref(is_thread_alive), *re, std::ref(gens[i]), std::ref(bufs[i]), c, k));
-			}
+			searchers.start([this, mv = *re](std::size_t i, const std::atomic<bool>& alive) {
+				tre.run_mcts_after(alive, mv, gens[i], buf_main, c, k, batch);
+			});
 
 			/*
 				calc time elp
@@ -755,6 +1232,23 @@ public:
 		return action();
 	}
 
+	/*
+		the main time replaces time, the byo-yomi is taken once the main time is used
+		the clock reported before is dropped, and no time limit keeps time as it is
+	*/
+	void time_settings(double main_time, double byo_yomi_time, int byo_yomi_stones) override {
+		clock_left = -1, clock_stones = 0;
+		if (main_time <= 0 && byo_yomi_time > 0 && byo_yomi_stones == 0) {
+			byo_time = 0, byo_stones = 0;
+			return;
+		}
+		time = main_time, byo_time = byo_yomi_time, byo_stones = byo_yomi_stones;
+	}
+
+	void time_left(double left, int stones) override {
+		clock_left = std::max(left, 0.0), clock_stones = stones;
+	}
+
 	virtual void close_episode(const std::string& flag = "") override {
 		/*
 			after mcts
@@ -774,10 +1268,14 @@ public:
 		if (stat && move_count) {
 			stat_out << move_count << " moves in " << time_elp << " ms\n";
 			stat_out << float(time_elp) / move_count << " ms/move\n";
+			stat_out << evictions << " evictions, " << evicted << " nodes evicted, " << exhaustions << " allocations failed\n";
 			// std::cout << float(time_elp) / move_count / T / thread_size << " mcts/ms\n";
 		}
 		move_count = 0;
 		time_elp = 0;
+		evictions = evicted = exhaustions = 0;
+		banked = 0;
+		clock_left = -1, clock_stones = 0;
 	}
 
 protected:
@@ -786,6 +1284,10 @@ protected:
 	*/
 	float c = 0.14; // explore rate
 	float k = 10.0; // rave 
+	std::size_t batch = 1; // leaves simulated at once, see playout.h
+	bool root_parallel = false; // parallel=root, every thread searches its own tree and the root children are summed
+	std::size_t tt = 0; // MB of the transposition table of each pool, 0 to search a tree instead of a DAG
+	pool::replace tt_replace = pool::replace::visits; // tt_replace=visits|always, see pool::insert()
 
 	/*
 		time management
@@ -795,7 +1297,18 @@ protected:
 	float c_time = 10; // dividing factor on time
 	float max_ply_mul = 1.3;
 	int max_ply = 14; // the move require most time
-	float mcts_per_ms = 210;
+	float byo_time = 0; // the byo-yomi period, see time_settings()
+	int byo_stones = 0; // the moves to play in a byo-yomi period, 0 if none
+	double clock_left = -1; // the clock reported by time_left(), -1 if not reported
+	int clock_stones = 0; // the moves to play in clock_left, 0 for the main time
+	float time_extend = 2; // the times of the budget spent while the root is unstable
+	enum class early { off, visits, bound } early_stop = early::visits; // early=off|visits|bound, see settled()
+	float early_c = 0.5; // the share of the rest simulations the second may gain, for early=visits
+	float early_z = 2.58; // the standard errors between the best and the others, for early=bound
+	float bank = 0.5; // the share of the banked time spent on the next move
+	double banked = 0; // ms saved by the early stops
+	float time_margin = 100; // ms of the clock never spent
+	// float mcts_per_ms = 210;
 	// float mcts_per_ms = 3;
 	
 	/*
@@ -807,13 +1320,15 @@ protected:
 		objects in parellel
 	*/
 	std::size_t thread_size = 14; // # of thread used
-	bool is_thread_alive = false; // switch to kill while-true thread
-	std::size_t reserve = 2000000; // buffer size aka expected number of mcts per move
+	bool pin = false; // pin the searchers to the cores in order
+	std::size_t memory = 0; // MB of all pools, 0 to reserve by reserve and reserve_main, see reclaim()
+	static constexpr std::size_t edges_per_node = 32;
+	std::size_t evictions = 0, evicted = 0, exhaustions = 0; // the reclaims, the nodes evicted, and the allocations failed
+	std::size_t reserve = 2000000; // nodes in the pool of each thread, only in root parallel
 	std::size_t reserve_main = 15000000;
 	std::vector<std::default_random_engine> gens; // random generator for each thread
-	std::vector<std::vector<node>> bufs; // node buffer for each thread
-	std::vector<node> buf_main; // node buffer for inherence
-	std::vector<std::thread> afters; // after mcts
+	std::vector<pool> bufs; // node pool for each thread, only in root parallel
+	pool buf_main; // node pool shared by the threads
 
 	/*
 		statistics
@@ -823,4 +1338,9 @@ protected:
 	int move_count = 0;
 	int time_elp = 0;
 	std::ofstream stat_out;
+
+	/*
+		the threads of think() and after mcts, declared last to be stopped before the pools are freed
+	*/
+	workers searchers;
 };
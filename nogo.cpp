@@ -11,12 +11,16 @@
 #include <fstream>
 #include <iterator>
 #include <string>
+#include <charconv>
+#include <cmath>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 #include "episode.h"
 #include "statistics.h"
 #include "agent_factory.h"
+#include "benchmark.h"
+#include "trainer.h"
 
 int main(int argc, const char* argv[]) {
 	std::cout << "HollowNoGo-Demo: ";
@@ -28,6 +32,12 @@ int main(int argc, const char* argv[]) {
 	std::string load_path, save_path;
 	std::string name = "TCG-HollowNoGo-Demo", version = "2022"; // for GTP shell
 	bool shell = false;
+	size_t perft = 0, playouts = 0, threads = 1; // for benchmarks
+	unsigned seed = 0;
+	std::string sgf_path;
+	size_t train = 0, checkpoint = 1000, sims = 1000, rollouts = 100; // for simulation balancing
+	float alpha = 0.1;
+	std::string weights_path = "weight.bin";
 	for (int i = 1; i < argc; i++) {
 		std::string arg = argv[i];
 		auto match_arg = [&](std::string flag) -> bool {
@@ -58,9 +68,45 @@ int main(int argc, const char* argv[]) {
 			version = next_opt();
 		} else if (match_arg("shell")) {
 			shell = true;
+		} else if (match_arg("perft")) {
+			perft = std::stoull(next_opt());
+		} else if (match_arg("playout-bench")) {
+			playouts = std::stoull(next_opt());
+		} else if (match_arg("sgf")) {
+			sgf_path = next_opt();
+		} else if (match_arg("threads")) {
+			threads = std::stoull(next_opt());
+		} else if (match_arg("seed")) {
+			seed = std::stoul(next_opt());
+		} else if (match_arg("train")) {
+			train = std::stoull(next_opt());
+		} else if (match_arg("weights")) {
+			weights_path = next_opt();
+		} else if (match_arg("checkpoint")) {
+			checkpoint = std::stoull(next_opt());
+		} else if (match_arg("sims")) {
+			sims = std::stoull(next_opt());
+		} else if (match_arg("rollouts")) {
+			rollouts = std::stoull(next_opt());
+		} else if (match_arg("alpha")) {
+			alpha = std::stof(next_opt());
 		}
 	}
 
+	if (perft || playouts) { // benchmark the board instead of playing games
+		benchmark bench(sgf_path.size() ? benchmark::load_sgf(sgf_path) : board(), threads, seed);
+		if (perft) bench.perft(perft);
+		if (playouts) bench.playout(playouts);
+		return 0;
+	}
+
+	if (train) { // train the weights of the heavy playouts instead of playing games
+		trainer train_weights(weights_path, threads, seed);
+		train_weights.sims = sims, train_weights.rollouts = rollouts, train_weights.alpha = alpha;
+		train_weights.run(train, checkpoint);
+		return 0;
+	}
+
 	statistics stats(total, block, limit);
 
 	if (load_path.size()) {
@@ -99,6 +145,11 @@ int main(int argc, const char* argv[]) {
 
 		}
 	} else { // launch GTP shell
+		// parse the whole text as a non-negative number, e.g., the arguments of the clock
+		auto parse = [](const std::string& text, auto& value) -> bool {
+			auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+			return ec == std::errc() && end == text.data() + text.size() && value >= 0 && std::isfinite(double(value));
+		};
 		for (std::string command; std::getline(std::cin, command); ) {
 			if (command.back() == '\r') command.pop_back();
 			if (command.empty()) continue;
@@ -179,6 +230,40 @@ int main(int argc, const char* argv[]) {
 				}
 				if (size > board::size_x || size > board::size_y) break;
 
+			} else if (args[0] == "time_settings" || args[0] == "kgs-time_settings") { // set the clock of both players
+				/*
+					kgs-time_settings none|absolute main|byoyomi main period periods|canadian main period stones
+					a byoyomi period covers a move, so only the last period is counted
+				*/
+				std::vector<std::string> opts(args.begin() + 1, args.end());
+				if (args[0] == "kgs-time_settings" && opts.size()) {
+					std::string type = opts[0];
+					opts.erase(opts.begin());
+					int periods;
+					if (type == "none") opts = {"0", "1", "0"};
+					else if (type == "absolute" && opts.size() == 1) opts = {opts[0], "0", "0"};
+					else if (type == "byoyomi" && opts.size() == 3 && parse(opts[2], periods)) opts = {opts[0], opts[1], "1"};
+					else if (type != "canadian") opts.clear();
+				}
+				double main_time, byo_time;
+				int byo_stones;
+				if (opts.size() == 3 && parse(opts[0], main_time) && parse(opts[1], byo_time) && parse(opts[2], byo_stones)) {
+					black->time_settings(main_time, byo_time, byo_stones);
+					white->time_settings(main_time, byo_time, byo_stones);
+				} else {
+					reply = "syntax error";
+				}
+
+			} else if (args[0] == "time_left") { // report the clock of a player
+				double left;
+				int stones;
+				if (args.size() == 4 && parse(args[2], left) && parse(args[3], stones)) {
+					agent& who = black->role()[0] == std::tolower(args[1][0]) ? *black : *white;
+					who.time_left(left, stones);
+				} else {
+					reply = "syntax error";
+				}
+
 			} else if (args[0] == "name") { // report the name of the program
 				reply = name;
 			} else if (args[0] == "version") { // report the version number of the program
@@ -187,6 +272,7 @@ int main(int argc, const char* argv[]) {
 				reply = "2";
 			} else if (args[0] == "list_commands") { // print supported commands
 				reply = "play\n" "genmove\n" "clear_board\n" "showboard\n" "boardsize\n"
+				        "time_settings\n" "kgs-time_settings\n" "time_left\n"
 				        "name\n" "version\n" "protocol_version\n" "list_commands\n" "quit\n";
 			} else {
 				reply = "unknown command";
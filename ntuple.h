@@ -137,10 +137,10 @@ public:
 		// std::cout << "take action\n";
 
 		stats.push_back({board(), 0});
+		board after = before;
+		board::undo rec;
 		for (int i = 0; i < board::size_x * board::size_y; ++i) {
-			board after = board(before);
-            auto mv = action::place(i, who);
-            if (mv.apply(after) != board::legal) continue;
+			if (after.try_place(i, rec, who) != board::legal) continue;
 			weight::type pot = get_potential(after);
 			// std::cout << "drct " << i << " reward " << rew << " pot " << pot << '\n';
 			if (best_drct == 5 || pot > best_value) {
@@ -148,6 +148,7 @@ public:
 				best_value = pot, best_drct = i;
 				stats.back() = {after, pot};
 			}
+			after.unplace(rec);
 		}
 		// std::cout << "best si drct " << best_drct << " with value " << best_value << '\n';
 
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+/**
+ * heavy playouts, the moves are drawn by the weights of their 3x3 patterns
+ *
+ * the pattern of a cell is the code of its 8 neighbors, 2 bits each, from the view of the side to move,
+ * 0: hollow or outside, 1: own stone, 2: opponent stone, 3: empty, the first neighbor (-1, -1) at the highest bits,
+ * so a table has 4^8 weights, the format of weight.bin by test/weight_init.cpp
+ * a move of code p is drawn with the probability proportional to exp(weight[p]), in fixed point, see gammas
+ *
+ * the codes of both views are kept up to date by each move, a stone only changes the codes of its 8 neighbors,
+ * and the weights of the legal moves are summed per row by their changes, so a draw walks the rows and then a row
+ */
+template<class board_type>
+class pattern_playout {
+public:
+	typedef typename board_type::bitboard bitboard;
+	typedef typename board_type::piece_type piece_type;
+	typedef uint32_t gamma_type;
+	static constexpr int cells = board_type::size_x * board_type::size_y;
+	static constexpr std::size_t codes = 1u << 16;
+
+	/*
+		load the weights of weight.bin, i.e., the size in uint64 and the weights in float
+	*/
+	static std::vector<float> load(const std::string& path) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in.is_open()) throw std::invalid_argument("cannot open weights: " + path);
+		uint64_t size = 0;
+		in.read(reinterpret_cast<char*>(&size), sizeof(size));
+		if (size != codes) throw std::invalid_argument("invalid weights: " + path);
+		std::vector<float> weight(size);
+		in.read(reinterpret_cast<char*>(weight.data()), sizeof(float) * size);
+		if (!in) throw std::invalid_argument("truncated weights: " + path);
+		return weight;
+	}
+
+	static void save(const std::string& path, const std::vector<float>& weight) {
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) throw std::invalid_argument("cannot open weights: " + path);
+		uint64_t size = weight.size();
+		out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		out.write(reinterpret_cast<const char*>(weight.data()), sizeof(float) * size);
+	}
+
+public:
+	pattern_playout(const std::vector<float>& weight) : gamma(codes) {
+		if (weight.size() != codes) throw std::invalid_argument("invalid weights: " + std::to_string(weight.size()));
+		for (auto p = 0u; p < codes; ++p) gamma[p] = gammas(weight[p]);
+	}
+
+	/*
+		exp(w) in fixed point, 1 << 12 for w = 0, clamped to [1, gamma_max] so that the sum of all cells fits 32 bits
+		the integers keep the sums exact under the changes of each move
+	*/
+	static gamma_type gammas(float w) {
+		return gamma_type(std::clamp(std::round(std::ldexp(std::exp(double(w)), 12)), 1.0, double(gamma_max)));
+	}
+	static constexpr gamma_type gamma_max = std::min<gamma_type>(1u << 24, std::numeric_limits<gamma_type>::max() / cells);
+
+	/**
+	 * a playout in progress on brd, the moves should be placed by place() to keep the codes
+	 */
+	class walk {
+	public:
+		walk(const pattern_playout& policy, board_type& brd) : gamma(policy.gamma.data()), brd(brd) {
+			uint8_t cell[cells + 1]; // the 2 bits of each cell in the black view, and 0 for outside at the end
+			for (int i = 0; i < cells; ++i) {
+				piece_type p = brd(i);
+				cell[i] = p == board_type::empty ? 3 : p == board_type::hollow ? 0 : p;
+			}
+			cell[cells] = 0;
+			for (int i = 0; i < cells; ++i) {
+				uint16_t code = 0;
+				for (int n : neighbors[i]) code = (code << 2) | cell[n < 0 ? cells : n];
+				view[1][i] = code, view[2][i] = flip(code);
+			}
+			for (unsigned who = 1; who <= 2; ++who) {
+				total[who] = 0;
+				for (int x = 0; x < board_type::size_x; ++x) rows[who][x] = 0;
+				for (int i = 0; i < cells; ++i) {
+					weight[who][i] = brd.available(who) & board_type::shifted(i) ? gamma[view[who][i]] : 0;
+					rows[who][i / board_type::size_y] += weight[who][i], total[who] += weight[who][i];
+				}
+			}
+		}
+
+		/*
+			draw a move of the side to move, or nullopt if none
+		*/
+		std::optional<int> action(std::default_random_engine& gen) {
+			unsigned who = brd.info().who_take_turns;
+			bitboard av = brd.available(who);
+			if (!av) return std::nullopt;
+			gamma_type r = std::uniform_int_distribution<gamma_type>(0, total[who] - 1)(gen);
+			int x = 0;
+			for (; r >= rows[who][x]; ++x) r -= rows[who][x];
+			int i = x * board_type::size_y;
+			for (; r >= weight[who][i]; ++i) r -= weight[who][i];
+			return i;
+		}
+
+		/*
+			place the move i of the side to move, and update the codes and the weights it changed
+		*/
+		void place(int i) {
+			unsigned who = brd.info().who_take_turns;
+			bitboard before[3] = {0, brd.available(1), brd.available(2)};
+			brd.place(i);
+			/*
+				empty (3) becomes who in the black view, and the opponent in the white view
+				a move never becomes legal again, so only the neighbors of nonzero weights are looked up
+			*/
+			for (int k = 0; k < 8; ++k) {
+				int n = neighbors[i][k];
+				if (n < 0) continue;
+				view[1][n] ^= (3 ^ who) << (2 * k);
+				view[2][n] ^= (3 ^ board_type::opponent(who)) << (2 * k);
+				for (unsigned side = 1; side <= 2; ++side)
+					if (weight[side][n]) assign(side, n, gamma[view[side][n]]);
+			}
+			/* the moves made illegal, including i */
+			for (unsigned side = 1; side <= 2; ++side)
+				for (bitboard v = before[side] ^ brd.available(side); v; v = board_type::reset(v))
+					assign(side, board_type::bit_scan(board_type::lsb(v)), 0);
+		}
+
+		// the code of the cell i from the view of who
+		uint16_t code(unsigned who, int i) const { return view[who][i]; }
+
+		// the probability that who draws the cell i
+		float chance(unsigned who, int i) const { return float(weight[who][i]) / total[who]; }
+
+	protected:
+		void assign(unsigned side, int n, gamma_type w) {
+			gamma_type d = w - weight[side][n]; // modulo 2^32, as the sums
+			weight[side][n] = w, rows[side][n / board_type::size_y] += d, total[side] += d;
+		}
+
+	private:
+		const gamma_type* gamma;
+		board_type& brd;
+		uint16_t view[3][cells]; // [1]: the codes from black's view, [2]: from white's
+		gamma_type weight[3][cells]; // the weights of the legal moves, 0 for the others
+		gamma_type rows[3][board_type::size_x]; // the sums of the weights of each row
+		gamma_type total[3];
+	};
+
+	/*
+		play brd to the end, and return the winner, the moves are added to moves[1] and moves[2] as simulate() of mcts
+	*/
+	piece_type run(board_type brd, std::default_random_engine& gen, bitboard moves[3]) const {
+		walk w(*this, brd);
+		while (auto mv = w.action(gen)) {
+			moves[brd.info().who_take_turns] |= board_type::shifted(*mv);
+			w.place(*mv);
+		}
+		return static_cast<piece_type>(board_type::opponent(brd.info().who_take_turns));
+	}
+
+	// the code from the other view, i.e., 1 and 2 swapped in every neighbor
+	static constexpr uint16_t flip(uint16_t code) {
+		uint16_t low = code & 0x5555, high = (code >> 1) & 0x5555;
+		uint16_t swap = low ^ high; // the neighbors of 1 or 2
+		return code ^ (swap | swap << 1);
+	}
+
+protected:
+	/*
+		the 8 neighbors of each cell in the order of the code, -1 if outside, the hollow cells are coded by the board
+		the k-th neighbor of a cell sees it as its (7 - k)-th, i.e., at the bits 2k
+	*/
+	static constexpr auto neighbors = [] {
+		std::array<std::array<int16_t, 8>, cells> nb{};
+		for (int i = 0; i < cells; ++i) {
+			int x = i / board_type::size_y, y = i % board_type::size_y, k = 0;
+			for (int dx = -1; dx <= 1; ++dx) {
+				for (int dy = -1; dy <= 1; ++dy) {
+					if (dx == 0 && dy == 0) continue;
+					int nx = x + dx, ny = y + dy;
+					bool inside = nx >= 0 && nx < board_type::size_x && ny >= 0 && ny < board_type::size_y;
+					nb[i][k++] = inside ? nx * board_type::size_y + ny : -1;
+				}
+			}
+		}
+		return nb;
+	}();
+
+	std::vector<gamma_type> gamma; // exp of the weights, see gammas()
+};
+
+typedef pattern_playout<board> heavy_playout;
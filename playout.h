@@ -0,0 +1,319 @@
+#pragma once
+
+#include <random>
+#include <type_traits>
+
+#include "board.h"
+
+/*
+	avx2 kernel is compiled on gcc x86_64 and picked at runtime by cpu detection
+*/
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BATCH_PLAYOUT_AVX2
+#define BATCH_PLAYOUT_TARGET __attribute__((target("avx2,bmi,bmi2,popcnt")))
+inline bool avx2_playout = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+#else
+inline bool avx2_playout = false;
+#endif
+
+/**
+ * random playouts of up to max_lanes independent positions at once
+ *
+ * the avx2 kernel advances 4 boards in lockstep, the two words of each bitboard in
+ * the lo and hi registers, and updates avl by the flood fill rules of the original
+ * board, which need no branch per lane once the results are masked per lane
+ * without avx2, the lanes are played one by one on copies of the boards, as single playouts
+ * either way, the result of a lane is a legal random playout as random_action() of board
+ */
+template<class board_type>
+class batch_playout {
+public:
+	typedef typename board_type::board_state board_state;
+	typedef typename board_type::bitboard bitboard;
+	typedef typename board_type::piece_type piece_type;
+	static constexpr std::size_t max_lanes = 8;
+
+	struct result {
+		piece_type winner;
+		bitboard moves[3]; // [1]: black's, [2]: white's moves during the playout, for amaf
+	};
+
+public:
+	/**
+	 * play states[0, n) to the end, n <= max_lanes
+	 */
+	static void run(const board_type* const states[], std::size_t n, std::default_random_engine& gen, result res[]) {
+#ifdef BATCH_PLAYOUT_AVX2
+		if constexpr (paddable) {
+			if (vectorized()) {
+				// two packs in lockstep run out of ymm registers, one after another is faster
+				for (std::size_t j = 0; j < n; j += 4) run_avx2(states + j, std::min<std::size_t>(n - j, 4), gen, res + j);
+				return;
+			}
+		}
+#endif
+		run_single(states, n, gen, res);
+	}
+
+	// whether run() takes the avx2 kernel, which needs the cpu and a board fitting the padded layout
+	static bool vectorized() {
+#ifdef BATCH_PLAYOUT_AVX2
+		if constexpr (paddable) return avx2_playout && hardware_bitops;
+#endif
+		return false;
+	}
+
+	// the plain loop of random_action() per lane, the copies keep the groups of the boards
+	static void run_single(const board_type* const states[], std::size_t n, std::default_random_engine& gen, result res[]) {
+		for (auto j = 0u; j < n; ++j) {
+			board_type brd = *states[j];
+			while (auto mv = brd.random_action(gen)) brd.place(*mv);
+			res[j].winner = brd.info().who_take_turns == board_type::white? board_type::black : board_type::white;
+			res[j].moves[0] = 0;
+			for (unsigned c = 1; c <= 2; ++c) res[j].moves[c] = stones(brd, c) ^ stones(*states[j], c);
+		}
+	}
+
+protected:
+	static bitboard stones(const board_state& s, unsigned who) { return s.brds[who]; }
+
+#ifdef BATCH_PLAYOUT_AVX2
+	/*
+		the kernel works on a padded layout, row x takes bits [x * row, x * row + size_y)
+		of lo for x < rows_lo, and of hi for the others
+		no row crosses the two words and the guard column at the right of each row takes
+		the horizontal overflow, so that shifting needs neither masks nor carries except between the words
+	*/
+	static constexpr int row = board_state::size_y + 1;
+	static constexpr int rows_lo = 64 / row;
+	static constexpr bool paddable = std::is_same_v<bitboard, uint128> && (board_state::size_x - rows_lo) * row <= 64;
+
+	struct padded {
+		std::uint64_t lo, hi;
+	};
+	static constexpr padded pad(uint128 v) {
+		padded r = {0, 0};
+		for (int x = 0; x < board_state::size_x; ++x) {
+			std::uint64_t bits = std::uint64_t(v >> (x * board_state::size_y)) & ((1ull << board_state::size_y) - 1);
+			if (x < rows_lo) r.lo |= bits << (x * row);
+			else r.hi |= bits << ((x - rows_lo) * row);
+		}
+		return r;
+	}
+	static constexpr uint128 unpad(std::uint64_t lo, std::uint64_t hi) {
+		uint128 r = 0;
+		for (int x = 0; x < board_state::size_x; ++x) {
+			std::uint64_t bits = (x < rows_lo? lo >> (x * row) : hi >> ((x - rows_lo) * row)) & ((1ull << board_state::size_y) - 1);
+			r |= uint128(bits) << (x * board_state::size_y);
+		}
+		return r;
+	}
+
+	/*
+		4 boards, lane j of lo and hi is board j
+	*/
+	struct pack {
+		__m256i lo, hi;
+
+		BATCH_PLAYOUT_TARGET pack operator &(const pack& b) const { return {_mm256_and_si256(lo, b.lo), _mm256_and_si256(hi, b.hi)}; }
+		BATCH_PLAYOUT_TARGET pack operator |(const pack& b) const { return {_mm256_or_si256(lo, b.lo), _mm256_or_si256(hi, b.hi)}; }
+		BATCH_PLAYOUT_TARGET pack operator ^(const pack& b) const { return {_mm256_xor_si256(lo, b.lo), _mm256_xor_si256(hi, b.hi)}; }
+		// ~*this & b
+		BATCH_PLAYOUT_TARGET pack andnot(const pack& b) const { return {_mm256_andnot_si256(lo, b.lo), _mm256_andnot_si256(hi, b.hi)}; }
+		// *this & m, m is a lane mask from zero() or at_most_one()
+		BATCH_PLAYOUT_TARGET pack select(__m256i m) const { return {_mm256_and_si256(lo, m), _mm256_and_si256(hi, m)}; }
+		BATCH_PLAYOUT_TARGET bool empty() const { __m256i d = _mm256_or_si256(lo, hi); return _mm256_testz_si256(d, d); }
+
+		BATCH_PLAYOUT_TARGET static pack broadcast(padded v) { return {_mm256_set1_epi64x(v.lo), _mm256_set1_epi64x(v.hi)}; }
+		BATCH_PLAYOUT_TARGET static pack load(const std::uint64_t* lo, const std::uint64_t* hi) {
+			return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi))};
+		}
+		BATCH_PLAYOUT_TARGET void store(std::uint64_t* lo_out, std::uint64_t* hi_out) const {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(lo_out), lo);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(hi_out), hi);
+		}
+	};
+
+	/*
+		the neighbors of v in the padded layout, may contain the guard column and unused bits,
+		which are never in a board so that they are dropped by any & with the boards
+	*/
+	BATCH_PLAYOUT_TARGET static pack shift_up(const pack& v) {
+		return {_mm256_or_si256(_mm256_srli_epi64(v.lo, row), _mm256_slli_epi64(v.hi, (rows_lo - 1) * row)), _mm256_srli_epi64(v.hi, row)};
+	}
+	BATCH_PLAYOUT_TARGET static pack shift_down(const pack& v) {
+		return {_mm256_slli_epi64(v.lo, row), _mm256_or_si256(_mm256_slli_epi64(v.hi, row), _mm256_srli_epi64(v.lo, (rows_lo - 1) * row))};
+	}
+	BATCH_PLAYOUT_TARGET static pack shift_right(const pack& v) { return {_mm256_slli_epi64(v.lo, 1), _mm256_slli_epi64(v.hi, 1)}; }
+	BATCH_PLAYOUT_TARGET static pack shift_left(const pack& v) { return {_mm256_srli_epi64(v.lo, 1), _mm256_srli_epi64(v.hi, 1)}; }
+	// the neighbors only, flow1 without v itself
+	BATCH_PLAYOUT_TARGET static pack spread(const pack& v) { return (shift_down(v) | shift_left(v)) | (shift_up(v) | shift_right(v)); }
+	BATCH_PLAYOUT_TARGET static pack flow1(const pack& v) { return v | spread(v); }
+
+	/*
+		grow the connected components v[act[i]] in brd[act[i]] for i in [0, n) together
+		until all of them converge in every lane
+		the floods are independent so that they overlap in the pipeline
+	*/
+	BATCH_PLAYOUT_TARGET static void cnnt_comp(pack v[], const pack brd[], const int act[], int n) {
+		while (true) {
+			__m256i diff = _mm256_setzero_si256();
+			for (int k = 0; k < n; ++k) {
+				int i = act[k];
+				auto nv = flow1(v[i]) & brd[i];
+				auto d = nv ^ v[i];
+				diff = _mm256_or_si256(diff, _mm256_or_si256(d.lo, d.hi));
+				v[i] = nv;
+			}
+			if (_mm256_testz_si256(diff, diff)) return;
+		}
+	}
+	BATCH_PLAYOUT_TARGET static pack libreties(const pack& cc, const pack& brd) { return brd.andnot(flow1(cc) ^ cc); }
+
+	// all ones in the lanes where v is 0
+	BATCH_PLAYOUT_TARGET static __m256i zero(const pack& v) {
+		return _mm256_cmpeq_epi64(_mm256_or_si256(v.lo, v.hi), _mm256_setzero_si256());
+	}
+	// all ones in the lanes where v has at most one 1 bit, i.e., reset(v) == 0 as count_one() of board
+	BATCH_PLAYOUT_TARGET static __m256i at_most_one(const pack& v) {
+		__m256i borrow = _mm256_cmpeq_epi64(v.lo, _mm256_setzero_si256());
+		__m256i lo = _mm256_and_si256(v.lo, _mm256_add_epi64(v.lo, _mm256_set1_epi64x(-1)));
+		__m256i hi = _mm256_and_si256(v.hi, _mm256_add_epi64(v.hi, borrow));
+		return _mm256_cmpeq_epi64(_mm256_or_si256(lo, hi), _mm256_setzero_si256());
+	}
+
+	/*
+		the same rules as update_librety of the flood fill board, see the history of board.h
+		the floods of the rules are issued in two rounds, since only the dead checks depend on others
+		me is the mover and already contains bb, op is the opponent
+		a lane with bb == 0 is left unchanged
+	*/
+	BATCH_PLAYOUT_TARGET static void update_librety(const pack& bb, const pack& me, const pack& op, pack& avl_me, pack& avl_op) {
+		constexpr padded inside = pad(board_state::board_mask), outside = {~inside.lo, ~inside.hi}; // outside: hollow, guard and unused
+		const auto wall = pack::broadcast(outside);
+		const auto me_bound = me | wall, op_bound = op | wall;
+		const auto emps = (me | op).andnot(pack::broadcast(inside));
+		const pack nbs[4] = {shift_up(bb), shift_down(bb), shift_left(bb), shift_right(bb)};
+
+		/*
+			round 1, [0]: the component of who containing bb
+			[1, 5): the components of opp besides bb
+		*/
+		pack cc[5], brd[5];
+		int act[9], n = 0;
+		cc[0] = bb, brd[0] = me, act[n++] = 0;
+		for (int d = 0; d < 4; ++d) {
+			cc[d + 1] = nbs[d] & op, brd[d + 1] = op;
+			if (!cc[d + 1].empty()) act[n++] = d + 1;
+		}
+		cnnt_comp(cc, brd, act, n);
+
+		/*
+			round 2, grow from the seeds
+			[0, 5): the last librety of the components above if only one remains
+			[5, 9): the empties besides bb without any empty neighbor, taken by opp
+		*/
+		const auto lonely = spread(emps).andnot(emps);
+		pack seed[9], fill[9], fbrd[9];
+		int grown = n;
+		n = 0;
+		for (int k = 0; k < grown; ++k) {
+			int i = act[k];
+			seed[i] = libreties(cc[i], i? me_bound : op_bound);
+			seed[i] = seed[i].select(at_most_one(seed[i]));
+			fill[i] = cc[i] | seed[i], fbrd[i] = (i? op : me) | seed[i];
+			if (!seed[i].empty()) act[n++] = i;
+		}
+		for (int d = 0; d < 4; ++d) {
+			int i = d + 5;
+			seed[i] = fill[i] = nbs[d] & lonely & avl_op, fbrd[i] = op | seed[i];
+			if (!seed[i].empty()) act[n++] = i;
+		}
+		cnnt_comp(fill, fbrd, act, n);
+
+		// type 1
+		avl_me = bb.andnot(avl_me);
+		avl_op = bb.andnot(avl_op);
+		for (int k = 0; k < n; ++k) {
+			int i = act[k];
+			// type 2 and 3, the last librety is forbidden to the opponent of the component
+			if (i == 0) avl_op = seed[i].andnot(avl_op);
+			else if (i < 5) avl_me = seed[i].andnot(avl_me);
+			// and also to the owner if filling it is dead, type 4 is the same for opp
+			auto dead = seed[i].select(zero(libreties(fill[i], i? me_bound : op_bound)));
+			if (i == 0) avl_me = dead.andnot(avl_me);
+			else avl_op = dead.andnot(avl_op);
+		}
+	}
+
+	/*
+		play up to 4 lanes to the end
+		the lanes keep the mover and the opponent instead of black and white,
+		so that every lane swaps them at the same time regardless of its side to move
+		move selection is scalar per lane, the rest is vectorized over the lanes
+	*/
+	BATCH_PLAYOUT_TARGET static void run_avx2(const board_type* const states[], std::size_t n, std::default_random_engine& gen, result res[]) {
+		std::uint64_t lo[4][4] = {}, hi[4][4] = {}; // mover, opponent, avl of mover, avl of opponent
+		unsigned who[4] = {};
+		bool alive[4] = {};
+		for (auto j = 0u; j < n; ++j) {
+			const board_state& s = *states[j];
+			who[j] = s.info().who_take_turns;
+			unsigned opp = board_state::opponent(who[j]);
+			const uint128 src[4] = {s.brds[who[j]], s.brds[opp], s.avl[who[j]], s.avl[opp]};
+			for (int t = 0; t < 4; ++t) {
+				auto v = pad(src[t]);
+				lo[t][j] = v.lo, hi[t][j] = v.hi;
+			}
+			alive[j] = true;
+		}
+		auto me = pack::load(lo[0], hi[0]), op = pack::load(lo[1], hi[1]);
+		auto avl_me = pack::load(lo[2], hi[2]), avl_op = pack::load(lo[3], hi[3]);
+
+		for (std::size_t remain = n; remain; ) {
+			/*
+				select the moves, the finished lanes place nothing
+			*/
+			std::uint64_t bb_lo[4] = {}, bb_hi[4] = {};
+			avl_me.store(lo[2], hi[2]);
+			for (auto j = 0; j < 4; ++j) {
+				if (!alive[j]) continue;
+				int cnt_lo = __builtin_popcountll(lo[2][j]), cnt = cnt_lo + __builtin_popcountll(hi[2][j]);
+				if (cnt) {
+					// the same choice as random_action() of board, the padding keeps the order of the cells
+					int idx = std::uniform_int_distribution<>(0, cnt - 1)(gen);
+					if (idx < cnt_lo) bb_lo[j] = _pdep_u64(1ull << idx, lo[2][j]);
+					else bb_hi[j] = _pdep_u64(1ull << (idx - cnt_lo), hi[2][j]);
+					continue;
+				}
+				/*
+					no move for the mover, record the lane
+				*/
+				me.store(lo[0], hi[0]);
+				op.store(lo[1], hi[1]);
+				const board_state& s = *states[j];
+				unsigned opp = board_state::opponent(who[j]);
+				res[j].winner = static_cast<piece_type>(opp);
+				res[j].moves[0] = 0;
+				res[j].moves[who[j]] = unpad(lo[0][j], hi[0][j]) ^ s.brds[who[j]];
+				res[j].moves[opp] = unpad(lo[1][j], hi[1][j]) ^ s.brds[opp];
+				alive[j] = false;
+				--remain;
+			}
+			if (!remain) break;
+
+			/*
+				place and update all lanes, then pass the turn
+			*/
+			auto bb = pack::load(bb_lo, bb_hi);
+			me = me | bb;
+			update_librety(bb, me, op, avl_me, avl_op);
+			std::swap(me, op);
+			std::swap(avl_me, avl_op);
+			for (auto j = 0; j < 4; ++j) who[j] = board_state::opponent(who[j]);
+		}
+	}
+#endif
+};
+
+typedef batch_playout<board> playout;
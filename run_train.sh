@@ -1,5 +1 @@
-while true
-do
-    ./nogo --total=1 --black="name=mcts balancing=1 thread=1 c=0.3 k=100 load=weight.bin save=weight.bin alpha=0.1" --white="name=mcts thread=1 c=0.1 k=100 time=10 skip=1"
-    ./nogo --total=1 --white="name=mcts balancing=1 thread=1 c=0.3 k=100 load=weight.bin save=weight.bin alpha=0.1" --black="name=mcts thread=1 c=0.1 k=100 time=10 skip=1"
-done
\ No newline at end of file
+./nogo --train=100000000 --weights=weight.bin --threads=$(nproc) --checkpoint=1000 --sims=1000 --rollouts=100 --alpha=0.1
@@ -0,0 +1,38 @@
+#include <chrono>
+#include "../board.h"
+
+using namespace std;
+
+/*
+    compare the portable and the hardware bit manipulation by random playouts from the empty board
+    the hardware bit manipulation is checked against the portable one by test_bitops
+    usage: ./bench_bitops [playouts] [seed]
+*/
+double run(size_t n, unsigned seed, bool hardware) {
+    hardware_bitops = hardware;
+    default_random_engine gen(seed);
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        board brd;
+        while (auto mv = brd.random_action(gen)) brd.place(*mv);
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - begin).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? stoul(argv[1]) : 200000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool detected = hardware_bitops;
+
+    double sw = run(n, seed, false);
+    cout << "portable: " << fixed << setprecision(3) << sw << " us/playout, " << setprecision(0) << 1e6 / sw << " playouts/s" << endl;
+    if (!detected) {
+        cout << "hardware: not supported by this cpu" << endl;
+        return 0;
+    }
+    double hw = run(n, seed, true);
+    cout << "hardware: " << fixed << setprecision(3) << hw << " us/playout, " << setprecision(0) << 1e6 / hw << " playouts/s" << endl;
+    cout << "speedup : " << setprecision(2) << sw / hw << "x" << endl;
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <chrono>
+#include "../pattern.h"
+
+using namespace std;
+
+/*
+    compare the uniform random playouts with the heavy playouts, from the empty board
+    the heavy playouts are checked by test_heavy
+    usage: ./bench_heavy [playouts] [seed]
+*/
+double run_light(size_t n, unsigned seed) {
+    default_random_engine gen(seed);
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        board brd;
+        while (auto mv = brd.random_action(gen)) brd.place(*mv);
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - begin).count() / n;
+}
+
+double run_heavy(size_t n, const heavy_playout& policy, unsigned seed) {
+    default_random_engine gen(seed);
+    board::bitboard moves[3];
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) policy.run(board(), gen, moves);
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - begin).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? stoul(argv[1]) : 100000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+
+    vector<float> random(heavy_playout::codes), skew(heavy_playout::codes);
+    default_random_engine gen(seed);
+    for (auto& w : random) w = normal_distribution<float>(0, 1)(gen);
+    for (auto& w : skew) w = normal_distribution<float>(0, 4)(gen);
+    heavy_playout uniform(vector<float>(heavy_playout::codes, 0.55f)), weighted(random), skewed(skew);
+
+    auto show = [](const string& name, double us, double base) {
+        cout << name << fixed << setprecision(3) << us << " us/playout, " << setprecision(0) << 1e6 / us << " playouts/s, "
+             << setprecision(2) << us / base << "x" << endl;
+    };
+    double base = run_light(n, seed);
+    show("light     : ", base, base);
+    show("uniform   : ", run_heavy(n, uniform, seed), base);
+    show("weighted  : ", run_heavy(n, weighted, seed), base);
+    show("skewed    : ", run_heavy(n, skewed, seed), base);
+    return 0;
+}
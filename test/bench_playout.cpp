@@ -0,0 +1,53 @@
+#include <chrono>
+#include "../playout.h"
+
+using namespace std;
+
+/*
+    compare one playout at a time with the batched playouts, from the empty board
+    the batched playouts are checked by test_playout
+    usage: ./bench_playout [playouts] [seed]
+*/
+double run(size_t n, unsigned seed, size_t lanes, bool avx2) {
+    avx2_playout = avx2;
+    default_random_engine gen(seed);
+    board empty;
+    const board* states[playout::max_lanes];
+    for (auto& s : states) s = &empty;
+    playout::result res[playout::max_lanes];
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i += lanes) playout::run(states, lanes, gen, res);
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - begin).count() / n;
+}
+
+double run_single(size_t n, unsigned seed) {
+    default_random_engine gen(seed);
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        board brd;
+        while (auto mv = brd.random_action(gen)) brd.place(*mv);
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, micro>(end - begin).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? stoul(argv[1]) : 200000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool detected = playout::vectorized();
+
+    auto show = [](const string& name, double us, double base) {
+        cout << name << fixed << setprecision(3) << us << " us/playout, " << setprecision(0) << 1e6 / us << " playouts/s, "
+             << setprecision(2) << base / us << "x" << endl;
+    };
+    double base = run_single(n, seed);
+    show("single    : ", base, base);
+    for (size_t lanes : {4, 8}) show("scalar x" + to_string(lanes) + " : ", run(n, seed, lanes, false), base);
+    if (!detected) {
+        cout << "avx2      : not supported by this cpu or board size" << endl;
+        return 0;
+    }
+    for (size_t lanes : {4, 8}) show("avx2 x" + to_string(lanes) + "   : ", run(n, seed, lanes, true), base);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "../board.h"
+
+using namespace std;
+
+/*
+    check the hardware bit manipulation against the portable one,
+    on random values of either half or both, and by random playouts, which should play the same games
+    usage: ./test_bitops [values] [seed]
+*/
+bool check_values(size_t values, unsigned seed) {
+#ifdef UINT128_HARDWARE_BITOPS
+    mt19937_64 gen(seed);
+    for (size_t i = 0; i < values; ++i) {
+        // sparse or dense values, in the low half, the high half or both
+        uint128 v = make_uint128(gen(), gen());
+        for (int k = gen() % 4; k--; ) v &= make_uint128(gen(), gen());
+        if (i % 3 == 1) v = uint64_t(v);
+        if (i % 3 == 2) v = v >> 64 << 64;
+        if (hardware::bit_count(v) != portable::bit_count(v)) return false;
+        for (int n = 0; n < portable::bit_count(v); ++n)
+            if (hardware::nth_one(v, n) != portable::nth_one(v, n)) return false;
+    }
+    for (int i = 0; i < 128; ++i)
+        if (hardware::bit_scan(shifted(i)) != i || portable::bit_scan(shifted(i)) != i) return false;
+#endif
+    return true;
+}
+
+bool check_playouts(size_t playouts, unsigned seed) {
+    vector<int> games[2];
+    for (bool hardware : {false, true}) {
+        hardware_bitops = hardware;
+        default_random_engine gen(seed);
+        for (size_t i = 0; i < playouts; ++i) {
+            board brd;
+            while (auto mv = brd.random_action(gen)) brd.place(*mv), games[hardware].push_back(*mv);
+            games[hardware].push_back(-1);
+        }
+    }
+    return games[0] == games[1];
+}
+
+int main(int argc, char* argv[]) {
+    size_t values = argc > 1 ? stoul(argv[1]) : 100000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+    if (!hardware_bitops) {
+        cout << "hardware  : not supported by this cpu" << endl;
+        return 0;
+    }
+    show("values    : ", check_values(values, seed));
+    show("playouts  : ", check_playouts(values / 100, seed));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <chrono>
+#include "../mcts.h"
+
+using namespace std;
+
+// the time management of mcts, which is protected
+struct player : mcts {
+    using mcts::mcts, mcts::allot, mcts::banked, mcts::settled, mcts::tre, mcts::pool, mcts::tree;
+};
+
+/*
+    check the time spent by the moves of mcts on the clock
+    usage: ./test_clock [seed]
+*/
+double spend(player& p, const board& brd, action& mv) {
+    auto begin = chrono::steady_clock::now();
+    mv = p.take_action(brd);
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+}
+
+/*
+    a forced move is played at once, and the time of its budget is banked,
+    while a move with choices is searched within the limit
+*/
+bool check_forced(unsigned seed) {
+    default_random_engine gen(seed);
+    board brd;
+    while (true) {
+        brd = board();
+        while (board::bit_count(brd.available()) > 1) brd.place(*brd.random_action(gen));
+        if (brd.available()) break;
+    }
+    player p("thread_size=1 reserve_main=1000000");
+    p.time_settings(60, 0, 0);
+    auto [budget, limit] = p.allot();
+    action mv;
+    double spent = spend(p, brd, mv);
+    if (mv != action::place(board::bit_scan(brd.available()), brd.info().who_take_turns)) return false;
+    if (spent > budget / 4 || p.banked < budget / 2) return false;
+
+    player q("thread_size=1 reserve_main=1000000");
+    q.time_settings(2, 0, 0);
+    tie(budget, limit) = q.allot();
+    spent = spend(q, board(), mv);
+    return mv.type() == action::place::type && spent <= limit + 50;
+}
+
+/*
+    the budget and the limit of a fresh player by the default parameters, c_time = 10, max_ply_mul = 1.3, max_ply = 14,
+    time_extend = 2 and time_margin = 100, i.e., the main time is shared by 28.2 moves,
+    a byo-yomi period by its stones, and the limit never spends the byo-yomi of the next period
+*/
+bool check_allot() {
+    auto near = [](pair<double, double> got, double budget, double limit) {
+        return abs(got.first - budget) < 1e-3 && abs(got.second - limit) < 1e-3;
+    };
+    player p("thread_size=1 reserve_main=1000");
+    p.time_settings(60, 0, 0); // sudden death
+    if (!near(p.allot(), 60000 / 28.2, 120000 / 28.2)) return false;
+    p.time_settings(0, 1, 0); // no time limit keeps the clock
+    if (!near(p.allot(), 60000 / 28.2, 120000 / 28.2)) return false;
+    p.time_left(1, 0);
+    if (!near(p.allot(), 1000 / 28.2, 2000 / 28.2)) return false;
+    p.time_left(0.05, 0); // within the margin
+    if (!near(p.allot(), 0, 0)) return false;
+
+    p.time_settings(0, 30, 10); // byo-yomi only, 3 s a move
+    if (!near(p.allot(), 2900, 2900)) return false;
+    p.time_left(20, 5);
+    if (!near(p.allot(), 4000, 8000)) return false;
+
+    p.time_settings(60, 30, 10); // the main time and byo-yomi, a move may always spend its byo-yomi share
+    if (!near(p.allot(), 3000, 6000)) return false;
+    p.time_left(1, 0);
+    return near(p.allot(), 3000, 3900);
+}
+
+/*
+    the early stops, visits: the second cannot catch up by early_c of the rest simulations,
+    bound: the win rate of the best is above the second by early_z standard errors,
+    and the time banked by them adds bank of it to the next budget
+*/
+bool check_early() {
+    player::pool buf(1000);
+    board brd;
+    player off("thread_size=1 reserve_main=1000 early=off");
+    if (off.settled(buf, 1000, 0, 0)) return false;
+
+    player visits("thread_size=1 reserve_main=1000 early=visits early_c=0.5");
+    if (!visits.settled(buf, 100, 40, 100) || visits.settled(buf, 100, 60, 100) || !visits.settled(buf, 100, 60, 70)) return false;
+
+    player bound("thread_size=1 reserve_main=1000 early=bound early_z=2.58");
+    bound.tre.initialze(brd, buf);
+    auto nd = buf.expend(player::tree::root, brd);
+    auto best = buf.firsts[nd], second = best + 1;
+    buf.visits[best] = buf.visits[second] = 1000; // the first of a tie is the best, and the wins are of the opponent
+    buf.wins[best] = 300, buf.wins[second] = 700;
+    if (!bound.settled(buf, 0, 0, 0)) return false;
+    buf.wins[best] = 480, buf.wins[second] = 520;
+    if (bound.settled(buf, 0, 0, 0)) return false;
+
+    player p("thread_size=1 reserve_main=1000 bank=0.5");
+    p.time_settings(60, 0, 0);
+    auto [budget, limit] = p.allot();
+    p.banked = 1000;
+    auto [more, more_limit] = p.allot();
+    return abs(more - budget - 500) < 1e-3 && abs(more_limit - 2 * more) < 1e-3;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = argc > 1 ? stoul(argv[1]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+    show("forced    : ", check_forced(seed));
+    show("allot     : ", check_allot());
+    show("early     : ", check_early());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include "../pattern.h"
+
+using namespace std;
+
+/*
+    check the heavy playouts from the empty board, every move should be legal and the game played to its end,
+    the codes kept by the walk should be the codes of a new walk,
+    and the chances of the legal moves should sum to 1, also with the weights at the clamp
+    usage: ./test_heavy [games] [seed]
+*/
+bool check(size_t games, const heavy_playout& policy, unsigned seed) {
+    default_random_engine gen(seed);
+    for (size_t g = 0; g < games; ++g) {
+        board brd;
+        heavy_playout::walk w(policy, brd);
+        while (auto mv = w.action(gen)) {
+            if (!(brd.available() & board::shifted(*mv))) return false;
+            double sum = 0;
+            for (auto av = brd.available(); av; av = board::reset(av))
+                sum += w.chance(brd.info().who_take_turns, board::bit_scan(board::lsb(av)));
+            if (abs(sum - 1) > 1e-3) return false;
+            w.place(*mv);
+            board copy = brd;
+            heavy_playout::walk fresh(policy, copy);
+            for (int i = 0; i < heavy_playout::cells; ++i)
+                for (unsigned who = 1; who <= 2; ++who)
+                    if (w.code(who, i) != fresh.code(who, i)) return false;
+        }
+        if (brd.available()) return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t games = argc > 1 ? stoul(argv[1]) : 200;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+
+    vector<float> random(heavy_playout::codes), skew(heavy_playout::codes);
+    default_random_engine gen(seed);
+    for (auto& w : random) w = normal_distribution<float>(0, 1)(gen);
+    for (auto& w : skew) w = normal_distribution<float>(0, 4)(gen);
+    heavy_playout weighted(random), skewed(skew);
+    heavy_playout saturated(vector<float>(heavy_playout::codes, 100)); // every weight at the clamp
+
+    show("weighted  : ", check(games, weighted, seed));
+    show("skewed    : ", check(games, skewed, seed));
+    show("saturated : ", check(games / 10, saturated, seed));
+    return ok ? 0 : 1;
+}
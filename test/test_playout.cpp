@@ -0,0 +1,75 @@
+#include "../playout.h"
+
+using namespace std;
+
+/*
+    check the batched playouts against boards played in the same order by random_action(),
+    every lane should be a legal random playout with its winner and the moves of each side
+    usage: ./test_playout [batches] [seed]
+*/
+board::bitboard stones(const board_state& s, unsigned who) {
+    board::bitboard re = 0;
+    for (int i = 0; i < board::size_x * board::size_y; ++i)
+        if (s(i) == who) re |= board::shifted(i);
+    return re;
+}
+
+/*
+    the avx2 kernel draws the moves of 4 lanes in turn, and the single playouts one lane after another
+*/
+bool check(size_t batches, unsigned seed, bool avx2) {
+    avx2_playout = avx2;
+    default_random_engine gen(seed), opening(seed + 1), ref(seed);
+    const size_t group = avx2 ? 4 : 1;
+    for (size_t g = 0; g < batches; ++g) {
+        board states[playout::max_lanes];
+        const board* ptrs[playout::max_lanes];
+        for (size_t j = 0; j < playout::max_lanes; ++j) {
+            board brd;
+            for (auto n = (g + j) % 30; n--; ) {
+                auto mv = brd.random_action(opening);
+                if (!mv) break;
+                brd.place(*mv);
+            }
+            states[j] = brd;
+            ptrs[j] = &states[j];
+        }
+        playout::result res[playout::max_lanes];
+        playout::run(ptrs, playout::max_lanes, gen, res);
+
+        for (size_t j0 = 0; j0 < playout::max_lanes; j0 += group) {
+            vector<board> brds(states + j0, states + j0 + group);
+            vector<bool> alive(group, true);
+            for (bool any = true; any; ) {
+                any = false;
+                for (size_t j = 0; j < group; ++j) {
+                    if (!alive[j]) continue;
+                    if (auto mv = brds[j].random_action(ref)) brds[j].place(*mv), any = true;
+                    else alive[j] = false;
+                }
+            }
+            for (size_t j = 0; j < group; ++j) {
+                auto& r = res[j0 + j];
+                if (r.winner != board::opponent(brds[j].info().who_take_turns)) return false;
+                for (unsigned c = 1; c <= 2; ++c)
+                    if (r.moves[c] != (stones(brds[j], c) ^ stones(states[j0 + j], c))) return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t batches = argc > 1 ? stoul(argv[1]) : 2000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+    bool detected = playout::vectorized();
+    show("single    : ", check(batches, seed, false));
+    if (detected) show("avx2      : ", check(batches, seed, true));
+    else cout << "avx2      : not supported by this cpu or board size" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#include "../board.h"
+
+using namespace std;
+
+/*
+    check settle() against full random playouts from the positions whose rest of the moves are independent
+    every playout should have the winner of settle(), and its loser should play exactly its legal moves,
+    and the moves of settle() should be as many as the playouts make
+    usage: ./test_settle [positions] [seed]
+*/
+bool check(size_t positions, unsigned seed, size_t& settled) {
+    default_random_engine gen(seed);
+    settled = 0;
+    for (size_t p = 0; p < positions; ++p) {
+        board brd;
+        constexpr int cells = board::size_x * board::size_y;
+        for (int n = uniform_int_distribution<>(cells / 4, cells)(gen); n--; ) {
+            auto mv = brd.random_action(gen);
+            if (!mv) break;
+            brd.place(*mv);
+        }
+        board::bitboard moves[3] = {};
+        board probe = brd;
+        auto win = probe.settle(gen, moves);
+        if (win == board::empty) continue;
+        ++settled;
+
+        unsigned who = brd.info().who_take_turns, lose = board::opponent(win);
+        if (moves[lose] != brd.available(lose)) return false;
+        if ((moves[win] & ~brd.available(win)) || (moves[1] & moves[2])) return false;
+        if (board::bit_count(moves[win]) != board::bit_count(moves[lose]) + (win == who)) return false;
+
+        for (int g = 0; g < 20; ++g) {
+            board game = brd;
+            board::bitboard played[3] = {};
+            while (auto mv = game.random_action(gen)) {
+                played[game.info().who_take_turns] |= board::shifted(*mv);
+                game.place(*mv);
+            }
+            if (board::opponent(game.info().who_take_turns) != unsigned(win)) return false;
+            if (played[lose] != brd.available(lose)) return false;
+            if (board::bit_count(played[win]) != board::bit_count(moves[win])) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t positions = argc > 1 ? stoul(argv[1]) : 20000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    size_t settled;
+    bool ok = check(positions, seed, settled) && settled > 0;
+    cout << "settle    : " << (ok ? "ok" : "WRONG") << ", " << settled << " of " << positions << " positions settled" << endl;
+    return ok ? 0 : 1;
+}
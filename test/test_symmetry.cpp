@@ -0,0 +1,67 @@
+#include "../board.h"
+
+using namespace std;
+
+/*
+    check the symmetries on random positions, each t of the symmetries should
+    - move the cells as transform_index(), and be undone by inverse(t)
+    - give the same state as the game replayed by the transformed moves, i.e., keep the rules and the hash
+    - keep the canonical state, which is the transform of the state by its canonical transform
+    usage: ./test_symmetry [positions] [seed]
+*/
+bool same(const board_state& a, const board_state& b) {
+    return a == b && a.hash() == b.hash() && a.info().who_take_turns == b.info().who_take_turns
+        && a.available(1) == b.available(1) && a.available(2) == b.available(2);
+}
+
+bool check_cells() {
+    for (int t = 0; t < board::symmetries; ++t) {
+        for (int i = 0; i < board::size_x * board::size_y; ++i) {
+            if (board::transform(board::shifted(i), t) != board::shifted(board::transform_index(i, t))) return false;
+            if (board::transform_index(board::transform_index(i, t), board::inverse(t)) != i) return false;
+        }
+    }
+    return true;
+}
+
+bool check_positions(size_t positions, unsigned seed) {
+    default_random_engine gen(seed);
+    for (size_t p = 0; p < positions; ++p) {
+        board brd;
+        vector<int> moves;
+        for (int n = uniform_int_distribution<>(0, 60)(gen); n--; ) {
+            auto mv = brd.random_action(gen);
+            if (!mv) break;
+            brd.place(*mv);
+            moves.push_back(*mv);
+        }
+
+        auto [canon, to] = brd.canonical();
+        if (!same(canon, brd.transformed(to))) return false;
+        for (int t = 0; t < board::symmetries; ++t) {
+            board_state s = brd.transformed(t);
+            if (!same(s.transformed(board::inverse(t)), brd)) return false;
+
+            board replay;
+            for (int mv : moves)
+                if (replay.place(board::transform_index(mv, t)) != board::legal) return false;
+            if (!same(replay, s)) return false;
+
+            if (!same(s.canonical().first, canon)) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t positions = argc > 1 ? stoul(argv[1]) : 2000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+    show("cells     : ", check_cells());
+    show("positions : ", check_positions(positions, seed));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,523 @@
+#include <thread>
+#include <unordered_map>
+#include "../mcts.h"
+
+using namespace std;
+
+// the pool and the tree of mcts, which are protected
+struct search : mcts {
+    using mcts::pool, mcts::tree;
+};
+typedef search::pool pool;
+typedef search::tree tree;
+typedef pool::index index_t;
+
+// the members of tree checked alone, which are protected
+struct probe : tree {
+    using tree::select, tree::simulate, tree::select_expend, tree::update, tree::run_batch, tree::batch_vloss;
+};
+
+/*
+    check the search tree of mcts by its invariants after the searches, the searches are random but the invariants are not
+    usage: ./test_tree [simulations] [seed]
+*/
+
+/*
+    a random position of n moves, so that the search reaches the transpositions and the ends of the game
+*/
+board opening(default_random_engine& gen, int n) {
+    board brd;
+    while (n--) {
+        auto mv = brd.random_action(gen);
+        if (!mv) break;
+        brd.place(*mv);
+    }
+    return brd;
+}
+
+/*
+    walk the nodes from the root, and check
+    - the total of a node is the sum of the visits of its edges, one per pass through the node
+    - the edge of a node is visited once more than the node is passed, its first visit simulates the leaf,
+      or more if threads break at the node being expended by another thread,
+      and any if the node is shared by the table or expended again after a release (loose)
+    - no more wins than visits, and the links to a node are its refs
+    - every node alive is reached, i.e., none is leaked
+*/
+enum class shape { serial, threaded, loose };
+
+bool consistent(const pool& buf, shape sh = shape::serial) {
+    vector<int> links(buf.node_cap);
+    vector<bool> seen(buf.node_cap);
+    vector<index_t> stack;
+    auto edge = [&](index_t e) {
+        if (buf.wins[e] < 0 || buf.wins[e] > buf.visits[e]) return false;
+        if (buf.rave_wins[e] < 0 || buf.rave_wins[e] > buf.rave_visits[e]) return false;
+        index_t nd = buf.nodes[e];
+        if (nd == pool::none) return true;
+        if (nd == pool::busy) return false;
+        int passed = buf.totals[nd] + (e != tree::root);
+        if (sh == shape::serial && buf.visits[e] != passed) return false;
+        if (sh == shape::threaded && buf.visits[e] < passed) return false;
+        if (!links[nd]++) stack.push_back(nd);
+        return true;
+    };
+    if (!edge(tree::root)) return false;
+    size_t reached = 0;
+    while (stack.size()) {
+        index_t nd = stack.back();
+        stack.pop_back();
+        ++reached;
+        long sum = 0;
+        for (auto e = buf.firsts[nd]; e < buf.firsts[nd] + buf.counts[nd]; ++e) {
+            if (!edge(e)) return false;
+            sum += buf.visits[e];
+        }
+        if (sum != buf.totals[nd]) return false;
+    }
+    for (index_t nd = 1; nd < min(buf.node_used, buf.node_cap); ++nd)
+        if (links[nd] && links[nd] != buf.refs[nd]) return false;
+    return reached == buf.node_size() - 1;
+}
+
+/*
+    a single search, every visit is a pass or a leaf
+*/
+bool check_serial(size_t sims, unsigned seed) {
+    board brd;
+    pool buf(sims * 100);
+    tree tre;
+    tre.initialze(brd, buf);
+    default_random_engine gen(seed);
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    return buf.visits[tree::root] == int(sims) && consistent(buf);
+}
+
+/*
+    threads search the same pool with virtual loss, every simulation is counted once and the virtual losses are reverted
+*/
+bool check_threads(size_t sims, unsigned seed) {
+    const size_t threads = 4;
+    board brd;
+    pool buf(sims * 100);
+    tree tre;
+    tre.vloss = 3;
+    tre.initialze(brd, buf);
+    vector<thread> thrs;
+    for (size_t i = 0; i < threads; ++i) {
+        thrs.emplace_back([&, i] {
+            default_random_engine gen(seed + i);
+            tre.run_mcts(sims, gen, buf, 0.14, 10);
+        });
+    }
+    for (auto& th : thrs) th.join();
+    return buf.visits[tree::root] == int(threads * sims) && consistent(buf, shape::threaded);
+}
+
+/*
+    the descents pending their simulations spread over the tree by the virtual losses,
+    fewer of them repeat the root move of an earlier one than without, and the tree is intact once they are updated
+    the lanes of a batch pend as the descents by batch_vloss, even if vloss is off
+*/
+size_t repeats(size_t sims, unsigned seed, int vloss, bool batch = false) {
+    const size_t pending = playout::max_lanes;
+    default_random_engine gen(seed);
+    board brd;
+    pool buf(sims * 100);
+    probe tre;
+    tre.initialze(brd, buf);
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    index_t nd = buf.nodes[tree::root];
+    vector<int> visits(buf.visits.get() + buf.firsts[nd], buf.visits.get() + buf.firsts[nd] + buf.counts[nd]);
+    tre.vloss = vloss;
+    if (batch) tre.run_batch(pending, gen, buf, 0.14, 10);
+    else {
+        vector<vector<index_t>> paths;
+        vector<board> leaves(pending);
+        for (size_t j = 0; j < pending; ++j) paths.push_back(tre.select_expend(buf, leaves[j], 0.14, 10));
+        for (size_t j = 0; j < pending; ++j) {
+            tree::rave_array ra = {};
+            tre.update(buf, paths[j], tre.simulate(leaves[j], gen, ra), ra);
+        }
+    }
+    if (buf.visits[tree::root] != int(sims + pending) || !consistent(buf)) return pending;
+    size_t distinct = 0;
+    for (index_t i = 0; i < buf.counts[nd]; ++i) distinct += buf.visits[buf.firsts[nd] + i] > visits[i];
+    return pending - distinct;
+}
+
+bool check_vloss(size_t sims, unsigned seed) {
+    size_t plain = 0, spread = 0, lanes = 0, pended = 0;
+    for (unsigned t = 0; t < 10; ++t) {
+        plain += repeats(sims, seed + t, 0);
+        spread += repeats(sims, seed + t, 10);
+        lanes += repeats(sims, seed + t, 0, true);
+        pended += repeats(sims, seed + t, probe::batch_vloss);
+    }
+    return 2 * spread < plain && lanes == pended && lanes < plain;
+}
+
+/*
+    root parallel, the pools searched from the same state are merged into an empty one,
+    whose root and its edges have the sums of their statistics
+*/
+bool check_merge(size_t sims, unsigned seed) {
+    board brd;
+    tree tre;
+    pool bufs[2], buf(sims * 100);
+    tre.initialze(brd, buf);
+    for (int i = 0; i < 2; ++i) {
+        bufs[i].reserve(sims * 100);
+        tre.initialze(brd, bufs[i]);
+        default_random_engine gen(seed + i);
+        tre.run_mcts(sims, gen, bufs[i], 0.14, 10);
+        tre.merge(bufs[i], buf);
+    }
+    index_t nd = buf.nodes[tree::root], a = bufs[0].nodes[tree::root], b = bufs[1].nodes[tree::root];
+    if (buf.visits[tree::root] != int(2 * sims) || buf.totals[nd] != bufs[0].totals[a] + bufs[1].totals[b]) return false;
+    if (buf.counts[nd] != bufs[0].counts[a] || buf.counts[nd] != bufs[1].counts[b]) return false;
+    for (index_t i = 0; i < buf.counts[nd]; ++i) {
+        index_t e = buf.firsts[nd] + i, ea = bufs[0].firsts[a] + i, eb = bufs[1].firsts[b] + i;
+        if (buf.moves[e] != bufs[0].moves[ea] || buf.moves[e] != bufs[1].moves[eb]) return false;
+        if (buf.visits[e] != bufs[0].visits[ea] + bufs[1].visits[eb] || buf.wins[e] != bufs[0].wins[ea] + bufs[1].wins[eb]) return false;
+        if (buf.rave_visits[e] != bufs[0].rave_visits[ea] + bufs[1].rave_visits[eb]) return false;
+    }
+    return consistent(buf);
+}
+
+/*
+    a small pool is filled up, the simulations are still counted, and the nodes released are allocated again,
+    which is the only way to grow once all edges are taken
+*/
+bool check_full(size_t sims, unsigned seed) {
+    board brd;
+    pool buf(2000);
+    tree tre;
+    tre.initialze(brd, buf);
+    default_random_engine gen(seed);
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    if (!buf.exhausted() || buf.exhausted() || buf.size() != buf.capacity()) return false;
+    if (buf.visits[tree::root] != int(sims) || !consistent(buf)) return false;
+
+    auto mv = tre.find_best_order(buf, 0);
+    size_t full = buf.node_size();
+    tre.move_after(*mv, buf);
+    size_t live = buf.node_size();
+    if (live >= full || !consistent(buf, shape::loose)) return false;
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    return buf.node_size() > live && buf.size() == buf.capacity() && consistent(buf, shape::loose);
+}
+
+/*
+    a pool with fewer nodes than its edges need runs out of nodes first,
+    the failed expansions after that should not take any more edges
+*/
+bool check_nodes(size_t sims, unsigned seed) {
+    board brd;
+    pool buf;
+    buf.reserve(20000, 0, pool::replace::visits, 100);
+    tree tre;
+    tre.initialze(brd, buf);
+    default_random_engine gen(seed);
+    tre.run_mcts(sims / 2, gen, buf, 0.14, 10);
+    size_t taken = buf.size();
+    if (!buf.exhausted() || buf.node_size() != 100 || taken >= buf.capacity()) return false;
+    tre.run_mcts(sims / 2, gen, buf, 0.14, 10);
+    return buf.exhausted() && buf.size() == taken && consistent(buf);
+}
+
+/*
+    with the table, the transpositions share their nodes, the moves a, b, c and c, b, a are expended in turn,
+    and reach one node linked twice, then the search goes on,
+    and every path to a node reaches the position of its key
+*/
+bool check_table(size_t sims, unsigned seed) {
+    default_random_engine gen(seed);
+    board brd;
+    int a = 0, b = 0, c = 0;
+    auto legal = [&](initializer_list<int> moves) {
+        board next = brd;
+        for (int mv : moves)
+            if (next.place(mv) != board::legal) return false;
+        return true;
+    };
+    do {
+        brd = opening(gen, board::size_x * board::size_y / 3);
+        vector<int> mine, theirs;
+        unsigned who = brd.info().who_take_turns;
+        for (auto av = brd.available(who); av; av = board::reset(av)) mine.push_back(board::bit_scan(board::lsb(av)));
+        for (auto av = brd.available(board::opponent(who)); av; av = board::reset(av)) theirs.push_back(board::bit_scan(board::lsb(av)));
+        if (mine.size() < 2 || theirs.empty()) continue;
+        shuffle(mine.begin(), mine.end(), gen);
+        a = mine[0], c = mine[1], b = theirs[gen() % theirs.size()];
+    } while (!legal({a, b, c}) || !legal({c, b, a}));
+
+    pool buf(sims * 100, 1);
+    tree tre;
+    tre.initialze(brd, buf);
+    auto reach = [&](initializer_list<int> moves) {
+        index_t e = tree::root;
+        board next = brd;
+        for (int mv : moves) {
+            index_t nd = buf.expend(e, next);
+            e = buf.firsts[nd];
+            while (buf.moves[e] != mv) ++e;
+            next.place(mv);
+        }
+        return buf.expend(e, next);
+    };
+    index_t shared = reach({a, b, c});
+    if (shared == pool::none || reach({c, b, a}) != shared || buf.refs[shared] != 2) return false;
+
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    if (buf.visits[tree::root] != int(sims) || buf.refs[shared] != 2 || !consistent(buf, shape::loose)) return false;
+    vector<bool> seen(buf.node_cap);
+    vector<pair<index_t, board>> stack = {{tree::root, brd}};
+    while (stack.size()) {
+        auto [e, next] = stack.back();
+        stack.pop_back();
+        index_t nd = buf.nodes[e];
+        if (e != tree::root) next.place(int(buf.moves[e]));
+        if (nd == pool::none) continue;
+        if (buf.keys[nd] != next.hash()) return false;
+        if (seen[nd]) continue;
+        seen[nd] = true;
+        for (auto ch = buf.firsts[nd]; ch < buf.firsts[nd] + buf.counts[nd]; ++ch) stack.push_back({ch, next});
+    }
+    return true;
+}
+
+/*
+    the tree is reused two moves later, the subtree of the position is promoted with its statistics,
+    the rest is released, so that the nodes alive are the nodes reached, and none once the root is released
+*/
+bool check_reuse(size_t sims, unsigned seed) {
+    default_random_engine gen(seed);
+    board brd = opening(gen, board::size_x * board::size_y / 3);
+    pool buf(sims * 100);
+    tree tre;
+    tre.initialze(brd, buf);
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+
+    index_t e = tree::root;
+    for (int d = 0; d < 2; ++d) {
+        index_t nd = buf.nodes[e], best = buf.firsts[nd];
+        for (auto ch = buf.firsts[nd]; ch < buf.firsts[nd] + buf.counts[nd]; ++ch)
+            if (buf.visits[ch] > buf.visits[best]) best = ch;
+        e = best;
+        brd.place(int(buf.moves[e]));
+    }
+    if (buf.nodes[e] == pool::none) return false;
+    int visits = buf.visits[e], wins = buf.wins[e], total = buf.totals[buf.nodes[e]];
+    size_t before = buf.node_size();
+    if (!tre.move(brd, buf) || tre.move(brd, buf)) return false;
+    index_t nd = buf.nodes[tree::root];
+    if (buf.visits[tree::root] != visits || buf.wins[tree::root] != wins || buf.totals[nd] != total) return false;
+    if (buf.node_size() >= before || !consistent(buf, shape::loose)) return false;
+
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    if (buf.visits[tree::root] != visits + int(sims) || !consistent(buf, shape::loose)) return false;
+    buf.release(buf.nodes[tree::root]);
+    buf.nodes[tree::root] = pool::none;
+    return tre.size(buf) == 0;
+}
+
+/*
+    the edges claimed by every node, as many as its passes if all, and at most pw_c * total^pw_alpha if pw,
+    whose alpha widens the root to half of its moves by the simulations, so that the root stays narrower on any board
+*/
+bool check_widening(size_t sims, unsigned seed) {
+    for (auto mode : {tree::widening::all, tree::widening::pw}) {
+        board brd;
+        pool buf(sims * 100);
+        tree tre;
+        tre.widening_mode = mode;
+        tre.pw_c = 1, tre.pw_alpha = log(board::bit_count(brd.available()) / 2.0) / log(double(sims));
+        tre.initialze(brd, buf);
+        default_random_engine gen(seed);
+        tre.run_mcts(sims, gen, buf, 0.14, 10);
+        if (!consistent(buf)) return false;
+
+        index_t root = buf.nodes[tree::root];
+        if (mode == tree::widening::pw && buf.nexts[root] >= buf.counts[root]) return false;
+        for (index_t nd = 1; nd < buf.node_used; ++nd) {
+            int claimed = buf.nexts[nd], total = buf.totals[nd];
+            if (mode == tree::widening::all && claimed != min(total, int(buf.counts[nd]))) return false;
+            if (mode == tree::widening::pw && (claimed > max(1.0, ceil(tre.pw_c * pow(total, tre.pw_alpha))) || (total && !claimed))) return false;
+        }
+    }
+    return true;
+}
+
+/*
+    select() scores the edges 8 at once by avx2, and picks the same edge as the scalar scores on every node,
+    also once some edges are marked proven, which a short search seldom reaches, to score them infinite
+*/
+bool check_select(size_t sims, unsigned seed) {
+    bool avx2 = avx2_select;
+    default_random_engine gen(seed);
+    board brd;
+    pool buf(sims * 100);
+    probe tre;
+    tre.initialze(brd, buf);
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    bool same = true;
+    for (int proven = 0; proven < 2; ++proven) {
+        for (index_t e = 1; proven && e < buf.size(); ++e)
+            buf.proofs[e] = uniform_int_distribution<>(0, 15)(gen) ? 0 : gen() % 2 ? 1 : -1;
+        for (index_t nd = 1; nd < buf.node_used && same; ++nd) {
+            avx2_select = avx2;
+            index_t a = tre.select(buf, nd, 0.14, 10);
+            avx2_select = false;
+            same = a == tre.select(buf, nd, 0.14, 10);
+        }
+    }
+    avx2_select = avx2;
+    return same;
+}
+
+/*
+    the amaf moves of a simulation are the stones it placed, as the same playout replayed by the same generator,
+    both for the uniform random and the heavy playouts, whose weights are random
+*/
+bool check_amaf(size_t positions, unsigned seed) {
+    default_random_engine gen(seed);
+    vector<float> weight(heavy_playout::codes);
+    for (auto& w : weight) w = normal_distribution<float>(0, 1)(gen);
+    auto heavy = make_shared<heavy_playout>(weight);
+    probe tre;
+    for (size_t p = 0; p < positions; ++p) {
+        board brd = opening(gen, uniform_int_distribution<>(0, board::size_x * board::size_y / 2)(gen));
+        tre.heavy = p % 2 ? heavy : nullptr;
+        default_random_engine sim(gen()), replay = sim;
+        tree::rave_array ra = {};
+        auto win = tre.simulate(brd, sim, ra);
+
+        board game = brd;
+        optional<heavy_playout::walk> policy;
+        if (tre.heavy) policy.emplace(*tre.heavy, game);
+        while (auto mv = policy ? policy->action(replay) : game.random_action(replay)) {
+            if (policy) policy->place(*mv);
+            else game.place(*mv);
+        }
+        if (win != board::opponent(game.info().who_take_turns)) return false;
+        board::bitboard played[3] = {};
+        for (int i = 0; i < board::size_x * board::size_y; ++i)
+            if (brd(i) == board::empty && game(i) != board::empty) played[game(i)] |= board::shifted(i);
+        if (ra[0] != played[board::black] || ra[1] != played[board::white]) return false;
+    }
+    return true;
+}
+
+/*
+    the subtrees below the edges visited fewer than least times are evicted, the statistics of all edges are kept,
+    and the nodes released are the ones counted
+*/
+bool check_evict(size_t sims, unsigned seed) {
+    board brd;
+    pool buf(sims * 100);
+    tree tre;
+    tre.initialze(brd, buf);
+    default_random_engine gen(seed);
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    vector<int> visits(buf.visits.get(), buf.visits.get() + buf.size()), wins(buf.wins.get(), buf.wins.get() + buf.size());
+
+    const int least = 8;
+    size_t live = buf.node_size(), evicted = tre.evict(buf, least);
+    if (!evicted || live - evicted != buf.node_size() || !consistent(buf)) return false;
+    for (index_t e = 0; e < buf.size(); ++e)
+        if (buf.visits[e] != visits[e] || buf.wins[e] != wins[e]) return false;
+    vector<index_t> stack = {buf.nodes[tree::root]};
+    while (stack.size()) {
+        index_t nd = stack.back();
+        stack.pop_back();
+        for (auto e = buf.firsts[nd]; e < buf.firsts[nd] + buf.counts[nd]; ++e) {
+            if (buf.nodes[e] == pool::none) continue;
+            if (buf.visits[e] < least) return false;
+            stack.push_back(buf.nodes[e]);
+        }
+    }
+    tre.run_mcts(sims, gen, buf, 0.14, 10);
+    return consistent(buf, shape::loose);
+}
+
+/*
+    whether the side to move wins, by exact negamax
+*/
+bool wins(const board& brd, unordered_map<uint64_t, bool>& known) {
+    if (auto it = known.find(brd.hash()); it != known.end()) return it->second;
+    bool win = false;
+    for (auto av = brd.available(); av && !win; av = board::reset(av)) {
+        board next = brd;
+        next.place(board::bit_scan(board::lsb(av)));
+        win = !wins(next, known);
+    }
+    return known[brd.hash()] = win;
+}
+
+/*
+    the solver on the endgames of few moves, a proven root agrees with negamax, and its best move keeps the win,
+    and the positions with a move that leaves the opponent no move are proven at once
+*/
+bool check_solver(size_t positions, unsigned seed, size_t& proven) {
+    default_random_engine gen(seed);
+    proven = 0;
+    for (size_t p = 0; p < positions; ++p) {
+        board brd;
+        while (board::bit_count(brd.available(board::black) | brd.available(board::white)) > 12) {
+            auto mv = brd.random_action(gen);
+            if (!mv) break;
+            brd.place(*mv);
+        }
+        if (!brd.available()) continue;
+        bool immediate = false;
+        for (auto av = brd.available(); av; av = board::reset(av)) {
+            board next = brd;
+            next.place(board::bit_scan(board::lsb(av)));
+            immediate = immediate || !next.available();
+        }
+
+        pool buf(200000);
+        tree tre;
+        tre.initialze(brd, buf);
+        tre.run_mcts(immediate ? 200 : 5000, gen, buf, 0.14, 10);
+        int result = tre.proven(buf);
+        if (immediate && result != 1) return false;
+        if (!result) continue;
+        ++proven;
+        unordered_map<uint64_t, bool> known;
+        if ((result > 0) != wins(brd, known)) return false;
+        if (result > 0) {
+            board next = brd;
+            next.place(action::place(*tre.find_best_order(buf, 0)).position().i);
+            if (wins(next, known)) return false;
+        }
+    }
+    return proven > 0;
+}
+
+int main(int argc, char* argv[]) {
+    size_t sims = argc > 1 ? stoul(argv[1]) : 20000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+    show("serial    : ", check_serial(sims, seed));
+    show("threads   : ", check_threads(sims, seed));
+    show("vloss     : ", check_vloss(sims, seed));
+    show("merge     : ", check_merge(sims, seed));
+    show("full      : ", check_full(sims, seed));
+    show("nodes     : ", check_nodes(sims, seed));
+    show("table     : ", check_table(sims, seed));
+    show("reuse     : ", check_reuse(sims, seed));
+    show("widening  : ", check_widening(sims, seed));
+    show(avx2_select ? "select    : " : "select    : (no avx2) ", check_select(sims, seed));
+    show("amaf      : ", check_amaf(sims / 10, seed));
+    show("evict     : ", check_evict(sims, seed));
+    size_t proven;
+    bool solved = check_solver(sims / 100, seed, proven);
+    cout << "solver    : " << (solved ? "ok" : "WRONG") << ", " << proven << " of " << sims / 100 << " endgames proven" << endl;
+    return ok && solved ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#include "../benchmark.h"
+
+using namespace std;
+
+/*
+    check try_place() and unplace() by random walks, which go down and back up at random,
+    the board walked in place should be the board copied and placed at each step,
+    i.e., the same state, hash and legal moves, and the same games played on from both, which reveals broken groups
+    and check the perft of benchmark, which walks in place, against the perft by copies
+    usage: ./test_undo [walks] [seed]
+*/
+bool same(const board& a, const board& b) {
+    return a == b && a.hash() == b.hash() && a.info().who_take_turns == b.info().who_take_turns
+        && a.available(1) == b.available(1) && a.available(2) == b.available(2);
+}
+
+bool check_walks(size_t walks, unsigned seed) {
+    default_random_engine gen(seed);
+    for (size_t w = 0; w < walks; ++w) {
+        board brd;
+        for (int n = uniform_int_distribution<>(0, board::size_x * board::size_y / 2)(gen); n--; ) {
+            auto mv = brd.random_action(gen);
+            if (!mv) break;
+            brd.place(*mv);
+        }
+        vector<board> copies = {brd};
+        vector<board::undo> recs;
+        for (int step = 0; step < 200; ++step) {
+            auto mv = brd.random_action(gen);
+            if (mv && (recs.empty() || gen() % 3)) {
+                board::undo rec;
+                if (brd.try_place(*mv, rec) != board::legal) return false;
+                recs.push_back(rec);
+                copies.push_back(copies.back());
+                copies.back().place(*mv);
+            } else if (recs.size()) {
+                brd.unplace(recs.back());
+                recs.pop_back();
+                copies.pop_back();
+            }
+            if (brd.depth() != recs.size() || !same(brd, copies.back())) return false;
+        }
+        while (recs.size()) {
+            brd.unplace(recs.back());
+            recs.pop_back();
+            copies.pop_back();
+        }
+        if (!same(brd, copies.back())) return false;
+
+        board game = copies.back();
+        while (auto mv = brd.random_action(gen)) {
+            if (game.place(*mv) != board::legal || brd.place(*mv) != board::legal || !same(brd, game)) return false;
+        }
+        if (game.random_action(gen)) return false;
+    }
+    return true;
+}
+
+// the perft of benchmark, which walks the moves by try_place() and unplace()
+struct counter : benchmark {
+    using benchmark::count;
+};
+
+// the perft by copying the board at each move
+uint64_t perft(const board& brd, unsigned depth) {
+    if (depth == 0) return 1;
+    uint64_t n = 0;
+    for (auto av = brd.available(); av; av = board::reset(av)) {
+        board next = brd;
+        next.place(board::bit_scan(board::lsb(av)));
+        n += perft(next, depth - 1);
+    }
+    return n;
+}
+
+/*
+    the perft of benchmark from random midgame positions, which should count as the perft by copies
+*/
+bool check_perft(size_t positions, unsigned seed) {
+    default_random_engine gen(seed);
+    constexpr int cells = board::size_x * board::size_y;
+    for (size_t p = 0; p < positions; ++p) {
+        board brd;
+        for (int n = uniform_int_distribution<>(cells / 4, cells / 2)(gen); n--; ) {
+            auto mv = brd.random_action(gen);
+            if (!mv) break;
+            brd.place(*mv);
+        }
+        board walked = brd;
+        if (counter::count(walked, 3) != perft(brd, 3) || !same(walked, brd)) return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t walks = argc > 1 ? stoul(argv[1]) : 3000;
+    unsigned seed = argc > 2 ? stoul(argv[2]) : 0;
+    bool ok = true;
+    auto show = [&](const string& name, bool pass) {
+        cout << name << (pass ? "ok" : "WRONG") << endl;
+        ok = ok && pass;
+    };
+    show("walks     : ", check_walks(walks, seed));
+    show("perft     : ", check_perft(walks / 15, seed));
+    return ok ? 0 : 1;
+}
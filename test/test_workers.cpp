@@ -0,0 +1,40 @@
+#include <iostream>
+#include <string>
+#include "../workers.h"
+
+using namespace std;
+
+/*
+    check the persistent threads by tasks started back to back, every thread should run every task exactly once,
+    both the tasks returning at once and the ones running until stopped, and no task should run after its stop
+    usage: ./test_workers [tasks] [threads]
+*/
+bool check(size_t tasks, size_t threads) {
+    vector<atomic<int>> runs(tasks * threads);
+    {
+        workers w;
+        w.spawn(threads);
+        for (size_t t = 0; t < tasks; ++t) {
+            w.start([&, t](size_t i, const atomic<bool>& alive) {
+                ++runs[t * threads + i];
+                if (t % 2) while (alive) this_thread::yield();
+            });
+        }
+        w.stop();
+        for (auto& n : runs) {
+            if (n != 1) return false;
+            n = 0;
+        }
+    } // the threads are joined
+    for (auto& n : runs)
+        if (n != 0) return false;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t tasks = argc > 1 ? stoul(argv[1]) : 1000;
+    size_t threads = argc > 2 ? stoul(argv[2]) : 4;
+    bool ok = check(tasks, threads);
+    cout << "workers   : " << (ok ? "ok" : "WRONG") << endl;
+    return ok ? 0 : 1;
+}
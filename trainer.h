@@ -0,0 +1,184 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * trainer.h: Simulation balancing of the weights of the heavy playouts
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "mcts.h"
+#include "pattern.h"
+#include "workers.h"
+
+/**
+ * train the weights of heavy_playout by simulation balancing in one process
+ *
+ * for a position s, the value V* of s is searched by mcts, V is the mean result of the heavy playouts from s,
+ * and g is the gradient of V by the weights, sampled by other heavy playouts as
+ *   g = mean of (z - V) * sum of psi(a_t) over the moves a_t of a playout of result z,
+ *   psi(a) = e(code of a) - sum of pi(b) * e(code of b) over the legal moves b, the gradient of log pi(a)
+ * then the weights are moved by alpha * (V* - V) * g, so that the playouts are balanced to the search
+ *
+ * every round, each thread draws a position by a heavy playout of random length and computes its step,
+ * the steps are summed into the weights at the end of the round, and the policy is rebuilt from them
+ * the weights are saved every checkpoint positions in the format of weight.bin, see test/weight_init.cpp
+ */
+class trainer {
+public:
+	trainer(const std::string& path, size_t threads = 1, unsigned seed = 0)
+		: path(path), threads(std::max<size_t>(threads, 1)), seed(seed) {
+		if (std::ifstream(path).is_open()) {
+			weight = heavy_playout::load(path);
+		} else {
+			std::cout << "train from the uniform weights, " << path << " does not exist" << std::endl;
+			weight.assign(heavy_playout::codes, 0);
+		}
+		gens.resize(this->threads);
+		bufs.resize(this->threads);
+		grads.assign(this->threads, std::vector<float>(heavy_playout::codes));
+		for (size_t i = 0; i < this->threads; ++i) gens[i].seed(seed + i);
+		crew.spawn(this->threads);
+	}
+
+public:
+	size_t sims = 1000; // the simulations of mcts for V*
+	size_t rollouts = 100; // the heavy playouts for V, and as many for g
+	float alpha = 0.1; // the learning rate
+	float c = 0.14, k = 10.0; // the search parameters of mcts, see mcts
+	int depth = 60; // the positions are drawn within the first depth moves
+
+	/**
+	 * train by the given number of positions, rounded up to the rounds of all threads
+	 *
+	 * the format of a checkpoint is
+	 * positions = 1024, V* = 0.512, V = 0.498, |V* - V| = 0.083, 12.3 s, 83 positions/s
+	 */
+	void run(size_t positions, size_t checkpoint = 1000) {
+		auto begin = std::chrono::steady_clock::now();
+		for (auto& buf : bufs) buf.reserve(sims * board::size_x * board::size_y + board::size_x * board::size_y, 0, mcts::pool::replace::visits, sims + 2);
+		std::vector<stat> stats(threads);
+		double sum_star = 0, sum_v = 0, sum_err = 0;
+		size_t done = 0, saved = 0;
+		while (done < positions) {
+			policy = std::make_unique<heavy_playout>(weight);
+			/* every thread takes one position, and stop() returns once all are done */
+			crew.start([&](size_t i, const std::atomic<bool>&) { stats[i] = balance(i); });
+			crew.stop();
+			for (size_t i = 0; i < threads; ++i) {
+				for (size_t p = 0; p < heavy_playout::codes; ++p) weight[p] += grads[i][p], grads[i][p] = 0;
+				sum_star += stats[i].star, sum_v += stats[i].value, sum_err += std::abs(stats[i].star - stats[i].value);
+			}
+			done += threads;
+
+			if (done - saved < checkpoint && done < positions) continue;
+			save();
+			double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			size_t n = done - saved;
+			std::cout << "positions = " << done << std::fixed << std::setprecision(3) << ", V* = " << sum_star / n
+			          << ", V = " << sum_v / n << ", |V* - V| = " << sum_err / n << ", " << std::setprecision(1) << sec << " s, "
+			          << std::setprecision(0) << done / std::max(sec, 1e-9) << " positions/s" << std::endl;
+			std::cout.unsetf(std::ios::floatfield);
+			sum_star = sum_v = sum_err = 0;
+			saved = done;
+		}
+	}
+
+	/*
+		save the weights, through a temporary file so that a checkpoint is never left half written
+	*/
+	void save() const {
+		heavy_playout::save(path + ".tmp", weight);
+		if (std::rename((path + ".tmp").c_str(), path.c_str()) != 0) throw std::runtime_error("cannot save weights: " + path);
+	}
+
+protected:
+	struct stat {
+		float star, value; // V* and V of the position
+	};
+
+	/*
+		draw a position, and add its step to grads[i]
+	*/
+	stat balance(size_t i) {
+		auto& gen = gens[i];
+		board state = draw(gen);
+		unsigned who = state.info().who_take_turns;
+
+		/*
+			V* by mcts with the uniform random playouts, the wins of the root are of the side to move
+		*/
+		auto& buf = bufs[i];
+		mcts::tree tre;
+		tre.initialze(state, buf);
+		tre.run_mcts(sims, gen, buf, c, k);
+		float star = float(buf.wins[mcts::tree::root]) / std::max(buf.visits[mcts::tree::root], 1);
+
+		/*
+			V by the heavy playouts, then g by as many others, centered by V
+		*/
+		float value = 0;
+		board::bitboard moves[3];
+		for (size_t n = 0; n < rollouts; ++n) value += policy->run(state, gen, moves) == who;
+		value /= rollouts;
+
+		auto& grad = grads[i];
+		float step = alpha * (star - value) / rollouts;
+		std::vector<std::pair<uint16_t, float>> psi;
+		for (size_t n = 0; n < rollouts; ++n) {
+			psi.clear();
+			board brd = state;
+			heavy_playout::walk w(*policy, brd);
+			while (auto mv = w.action(gen)) {
+				unsigned mover = brd.info().who_take_turns;
+				psi.push_back({w.code(mover, *mv), 1});
+				for (auto av = brd.available(mover); av; av = board::reset(av)) {
+					int b = board::bit_scan(board::lsb(av));
+					psi.push_back({w.code(mover, b), -w.chance(mover, b)});
+				}
+				w.place(*mv);
+			}
+			float z = brd.info().who_take_turns != who; // the side to move at the end loses
+			for (auto& [code, v] : psi) grad[code] += step * (z - value) * v;
+		}
+		return {star, value};
+	}
+
+	/*
+		the position after a heavy playout of random length from the empty board, which still has moves
+	*/
+	board draw(std::default_random_engine& gen) const {
+		board brd;
+		heavy_playout::walk w(*policy, brd);
+		for (int n = std::uniform_int_distribution<>(0, depth - 1)(gen); n--; ) {
+			auto mv = w.action(gen);
+			if (!mv) break;
+			board next = brd;
+			next.place(*mv);
+			if (!next.available()) break;
+			w.place(*mv);
+		}
+		return brd;
+	}
+
+private:
+	std::string path;
+	size_t threads;
+	unsigned seed;
+	std::vector<float> weight;
+	std::unique_ptr<heavy_playout> policy; // rebuilt from weight every round
+	std::vector<std::default_random_engine> gens; // random generator for each thread
+	std::vector<mcts::pool> bufs; // the pool of the search of each thread, reserved for sims
+	std::vector<std::vector<float>> grads; // the steps of each thread in a round
+	workers crew; // the last member, so the threads are joined before the others are destroyed
+};
@@ -3,6 +3,9 @@
 #include <cstdint>
 #include <iostream>
 #include <iomanip>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 
 using uint128 = __uint128_t;
@@ -39,7 +42,22 @@ int ith_one(uint128 cur, uint128 v) {
     return re;
 }
 
-int bit_count(uint128 v) {
+/*
+    portable bit manipulation, SWAR and binary search on the whole uint128
+*/
+namespace portable {
+
+// the bit index, ensure v has only one 1 bit
+inline int bit_scan(uint128 v) {
+    int re = 0, step = 64;
+    while (step) {
+        if (v >> step) re += step, v >>= step;
+        step >>= 1;
+    }
+    return re;
+}
+
+inline int bit_count(uint128 v) {
     const constexpr uint128 flt1 = make_uint128(0x5555555555555555, 0x5555555555555555);
     const constexpr uint128 flt2 = make_uint128(0x3333333333333333, 0x3333333333333333);
     const constexpr uint128 flt3 = make_uint128(0x0f0f0f0f0f0f0f0f, 0x0f0f0f0f0f0f0f0f);
@@ -52,6 +70,71 @@ int bit_count(uint128 v) {
     return (v * mul) >> 120;
 }
 
+// the bit index of the n-th (0-based) 1 bit of v, ensure n < bit_count(v)
+inline int nth_one(uint128 v, int n) {
+    while (n--) v = reset(v);
+    return bit_scan(lsb(v));
+}
+
+} // namespace portable
+
+/*
+    hardware bit manipulation, tzcnt, popcnt and pdep on the two 64-bit halves
+*/
+#if defined(__x86_64__) && defined(__GNUC__)
+#define UINT128_HARDWARE_BITOPS
+namespace hardware {
+
+__attribute__((target("bmi,bmi2,popcnt"))) inline int bit_scan(uint128 v) {
+    std::uint64_t lo = v;
+    return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll(std::uint64_t(v >> 64));
+}
+
+__attribute__((target("bmi,bmi2,popcnt"))) inline int bit_count(uint128 v) {
+    return __builtin_popcountll(std::uint64_t(v)) + __builtin_popcountll(std::uint64_t(v >> 64));
+}
+
+__attribute__((target("bmi,bmi2,popcnt"))) inline int nth_one(uint128 v, int n) {
+    std::uint64_t lo = v, hi = v >> 64;
+    int cnt = __builtin_popcountll(lo);
+    if (n < cnt) return __builtin_ctzll(_pdep_u64(1ull << n, lo));
+    return 64 + __builtin_ctzll(_pdep_u64(1ull << (n - cnt), hi));
+}
+
+} // namespace hardware
+#endif
+
+/*
+    the implementation is picked once at startup by cpu detection,
+    set it to false to force the portable version, e.g., for benchmarking
+*/
+#ifdef UINT128_HARDWARE_BITOPS
+inline bool hardware_bitops = __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+#else
+inline bool hardware_bitops = false;
+#endif
+
+inline int bit_scan(uint128 v) {
+#ifdef UINT128_HARDWARE_BITOPS
+    if (hardware_bitops) return hardware::bit_scan(v);
+#endif
+    return portable::bit_scan(v);
+}
+
+inline int bit_count(uint128 v) {
+#ifdef UINT128_HARDWARE_BITOPS
+    if (hardware_bitops) return hardware::bit_count(v);
+#endif
+    return portable::bit_count(v);
+}
+
+inline int nth_one(uint128 v, int n) {
+#ifdef UINT128_HARDWARE_BITOPS
+    if (hardware_bitops) return hardware::nth_one(v, n);
+#endif
+    return portable::nth_one(v, n);
+}
+
 // std::ostream& operator<<(std::ostream& out, const uint128& v) {
 //     out << std::hex << std::setfill('0') << std::setw(16) << static_cast<uint64_t>(v >> 64) << " | " << std::hex << std::setfill('0') << std::setw(16) << static_cast<uint64_t>(v);
 //     return out;
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * persistent threads running one task at a time, e.g., the search of a move or the pondering after it
+ *
+ * the threads are created once and wait for the next task, so a move pays no thread startup,
+ * a task runs on every thread as task(i, alive) until alive is cleared by stop(),
+ * and start() hands the threads over from the running task to the next one
+ * the threads are pinned to the cores in order if asked, which keeps their caches warm on idle machines
+ */
+class workers {
+public:
+	using task_type = std::function<void(std::size_t, const std::atomic<bool>&)>;
+
+	workers() = default;
+	workers(const workers&) = delete;
+	workers& operator=(const workers&) = delete;
+	~workers() { stop(); } // the threads are asked to stop and joined by std::jthread
+
+	/*
+		create n threads, pinned to the cores in order if pin
+		**ENSURE** called once before start()
+	*/
+	void spawn(std::size_t n, bool pin = false) {
+		pinned = pin;
+		for (auto i = 0u; i < n; ++i)
+			thrs.emplace_back([this, i](std::stop_token token) { work(token, i); });
+	}
+
+	/*
+		stop the running task, and run the task on all threads
+	*/
+	void start(task_type job) {
+		stop();
+		std::lock_guard lock(mtx);
+		task = std::move(job);
+		alive = true;
+		running = thrs.size();
+		++generation;
+		wake.notify_all();
+	}
+
+	/*
+		clear alive and wait until every thread is out of the task
+	*/
+	void stop() {
+		alive = false;
+		std::unique_lock lock(mtx);
+		idle.wait(lock, [&] { return running == 0; });
+	}
+
+	std::size_t size() const { return thrs.size(); }
+
+protected:
+	void work(std::stop_token token, std::size_t i) {
+		if (pinned) pin(i);
+		std::size_t seen = 0;
+		while (true) {
+			task_type job;
+			{
+				std::unique_lock lock(mtx);
+				if (!wake.wait(lock, token, [&] { return generation != seen; })) return;
+				seen = generation;
+				job = task;
+			}
+			job(i, alive);
+			{
+				std::lock_guard lock(mtx);
+				--running;
+			}
+			idle.notify_all();
+		}
+	}
+
+	static void pin(std::size_t i) {
+#if defined(__linux__)
+		unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(i % cores, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set); // best effort, e.g., out of the cpuset of a container
+#endif
+	}
+
+private:
+	std::mutex mtx;
+	std::condition_variable_any wake; // a new task, or the stop of the threads
+	std::condition_variable idle; // a thread is out of the task
+	task_type task;
+	std::atomic<bool> alive = false; // cleared to stop the task
+	std::size_t generation = 0; // the tasks started
+	std::size_t running = 0; // the threads not out of the current task yet
+	bool pinned = false;
+	std::vector<std::jthread> thrs; // the last member, so the threads are joined before the others are destroyed
+};